@@ -0,0 +1,192 @@
+//
+//  benchmark.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 6/23/25.
+//
+
+#include "benchmark.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool CameraPath::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open camera path " << path << "\n";
+        return false;
+    }
+
+    keyframes.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream stream(line);
+        CameraKeyframe key;
+        if (!(stream >> key.time))
+            continue;
+
+        if (!(stream >> key.eye.x >> key.eye.y >> key.eye.z
+                     >> key.target.x >> key.target.y >> key.target.z
+                     >> key.up.x >> key.up.y >> key.up.z)) {
+            std::cerr << path << ":" << lineNumber << ": expected time, eye, target and up\n";
+            return false;
+        }
+
+        std::string projection;
+        if (stream >> projection) {
+            if (projection == "orthographic")
+                key.projection = Camera::ProjectionType::Orthographic;
+            else if (projection == "reversedz")
+                key.projection = Camera::ProjectionType::ReversedZ;
+            else if (projection != "perspective") {
+                std::cerr << path << ":" << lineNumber << ": unknown projection " << projection << "\n";
+                return false;
+            }
+        }
+        keyframes.push_back(key);
+    }
+
+    if (keyframes.empty()) {
+        std::cerr << "Camera path " << path << " has no keyframes\n";
+        return false;
+    }
+
+    std::stable_sort(keyframes.begin(), keyframes.end(),
+                     [](const CameraKeyframe& a, const CameraKeyframe& b) { return a.time < b.time; });
+    return true;
+}
+
+void CameraPath::setDefaultOrbit() {
+    keyframes.clear();
+    const int steps = 8;
+    for (int i = 0; i <= steps; ++i) {
+        float angle = glm::radians(360.0f * i / steps);
+        CameraKeyframe key;
+        key.time = static_cast<float>(i);
+        key.eye = glm::dvec3(4.0 * std::cos(angle), 2.0, 4.0 * std::sin(angle));
+        key.target = glm::dvec3(0.0);
+        key.up = glm::dvec3(0.0, 1.0, 0.0);
+        key.projection = (i % 4 == 3) ? Camera::ProjectionType::Orthographic : Camera::ProjectionType::Perspective;
+        keyframes.push_back(key);
+    }
+}
+
+void CameraPath::apply(Camera& camera, float progress) const {
+    if (keyframes.empty())
+        return;
+
+    float start = keyframes.front().time;
+    float time = start + glm::clamp(progress, 0.0f, 1.0f) * (keyframes.back().time - start);
+
+    size_t next = 1;
+    while (next < keyframes.size() && keyframes[next].time < time)
+        ++next;
+
+    if (next >= keyframes.size()) {
+        const CameraKeyframe& key = keyframes.back();
+        camera.setProjectionType(key.projection);
+        camera.lookAt(key.eye, key.target, key.up);
+        return;
+    }
+
+    const CameraKeyframe& a = keyframes[next - 1];
+    const CameraKeyframe& b = keyframes[next];
+    float span = b.time - a.time;
+    double t = span > 0.0f ? (time - a.time) / span : 1.0;
+
+    camera.setProjectionType(a.projection);
+    camera.lookAt(glm::mix(a.eye, b.eye, t), glm::mix(a.target, b.target, t),
+                  glm::normalize(glm::mix(a.up, b.up, t)));
+}
+
+void FrameTimer::init() {
+    glGenQueries(kQueryCount, queries);
+}
+
+void FrameTimer::beginFrame() {
+    auto now = std::chrono::steady_clock::now();
+    if (hasLastFrame)
+        cpuTimes.push_back(std::chrono::duration<double, std::milli>(now - lastFrameStart).count());
+    lastFrameStart = now;
+    hasLastFrame = true;
+
+    // Reuse the oldest query only once its result has been read back
+    collect(queryPending == kQueryCount);
+    glBeginQuery(GL_TIME_ELAPSED, queries[queryHead]);
+}
+
+void FrameTimer::endFrame() {
+    glEndQuery(GL_TIME_ELAPSED);
+    queryHead = (queryHead + 1) % kQueryCount;
+    ++queryPending;
+}
+
+void FrameTimer::collect(bool wait) {
+    while (queryPending > 0) {
+        GLuint query = queries[(queryHead - queryPending + kQueryCount) % kQueryCount];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available && !wait)
+            return;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+        gpuTimes.push_back(elapsed / 1.0e6);
+        --queryPending;
+        wait = false;
+    }
+}
+
+void FrameTimer::finish() {
+    auto now = std::chrono::steady_clock::now();
+    if (hasLastFrame)
+        cpuTimes.push_back(std::chrono::duration<double, std::milli>(now - lastFrameStart).count());
+    hasLastFrame = false;
+
+    while (queryPending > 0)
+        collect(true);
+}
+
+void FrameTimer::cleanup() {
+    glDeleteQueries(kQueryCount, queries);
+}
+
+static void writeStats(std::ostream& out, const char* name, std::vector<double> times) {
+    out << "  \"" << name << "\": {";
+    if (times.empty()) {
+        out << "}";
+        return;
+    }
+
+    std::sort(times.begin(), times.end());
+    // Nearest-rank percentile
+    auto percentile = [&](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * times.size()));
+        return times[std::min(std::max<size_t>(rank, 1), times.size()) - 1];
+    };
+
+    out << "\"min\": " << times.front()
+        << ", \"p50\": " << percentile(50)
+        << ", \"p95\": " << percentile(95)
+        << ", \"p99\": " << percentile(99)
+        << ", \"max\": " << times.back() << "}";
+}
+
+bool writeBenchmarkReport(std::ostream& out, const FrameTimer& timer, int frames) {
+    out << "{\n";
+    out << "  \"frames\": " << frames << ",\n";
+    writeStats(out, "cpu_ms", timer.getCpuTimes());
+    out << ",\n";
+    writeStats(out, "gpu_ms", timer.getGpuTimes());
+    out << "\n}\n";
+    out.flush();
+    return static_cast<bool>(out);
+}
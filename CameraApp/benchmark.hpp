@@ -0,0 +1,69 @@
+//
+//  benchmark.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 6/23/25.
+//
+
+#ifndef benchmark_hpp
+#define benchmark_hpp
+
+#pragma once
+
+#include <GL/glew.h>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "camera.hpp"
+
+struct CameraKeyframe {
+    float time = 0.0f;
+    glm::dvec3 eye, target, up;
+    Camera::ProjectionType projection = Camera::ProjectionType::Perspective;
+};
+
+// Keyframed flythrough, sampled by normalized progress so every run renders the same views
+class CameraPath {
+public:
+    // One keyframe per line: time eye.xyz target.xyz up.xyz [perspective|orthographic|reversedz]
+    bool load(const std::string& path);
+    void setDefaultOrbit();
+
+    // progress in [0, 1]; positions are interpolated, projection switches at each keyframe
+    void apply(Camera& camera, float progress) const;
+
+private:
+    std::vector<CameraKeyframe> keyframes;
+};
+
+// CPU frame-to-frame times plus GPU times from a ring of GL_TIME_ELAPSED queries
+class FrameTimer {
+public:
+    void init();
+    void beginFrame();
+    void endFrame();
+    // Waits for the queries still in flight
+    void finish();
+    void cleanup();
+
+    const std::vector<double>& getCpuTimes() const { return cpuTimes; }
+    const std::vector<double>& getGpuTimes() const { return gpuTimes; }
+
+private:
+    static constexpr int kQueryCount = 4;
+
+    GLuint queries[kQueryCount] = {};
+    int queryHead = 0, queryPending = 0;
+    std::chrono::steady_clock::time_point lastFrameStart;
+    bool hasLastFrame = false;
+    std::vector<double> cpuTimes, gpuTimes; // milliseconds
+
+    void collect(bool wait);
+};
+
+// False when the stream failed, e.g. a full disk
+bool writeBenchmarkReport(std::ostream& out, const FrameTimer& timer, int frames);
+
+#endif /* benchmark_hpp */
@@ -0,0 +1,366 @@
+//
+//  bvh.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/7/25.
+//
+
+#include "bvh.hpp"
+#include "mesh.hpp"
+#include "parallel.hpp"
+
+#include <atomic>
+#include <future>
+#include <mutex>
+
+namespace {
+
+constexpr int kBinCount = 16;
+constexpr uint32_t kMaxLeafSize = 8;
+constexpr int kMaxDepth = 48;                  // keeps the traversal stack bounded
+constexpr size_t kParallelBinning = 1 << 17;   // primitives per node before binning is split across threads
+constexpr size_t kParallelSubtree = 1 << 13;   // primitives per node before a child gets its own thread
+
+struct Bin {
+    BoundingBox bounds;
+    BoundingBox centroidBounds;
+    uint32_t count = 0;
+};
+
+struct AxisBins {
+    Bin bins[3][kBinCount];
+
+    void merge(const AxisBins& other) {
+        for (int axis = 0; axis < 3; ++axis) {
+            for (int b = 0; b < kBinCount; ++b) {
+                expandBounds(bins[axis][b].bounds, other.bins[axis][b].bounds);
+                expandBounds(bins[axis][b].centroidBounds, other.bins[axis][b].centroidBounds);
+                bins[axis][b].count += other.bins[axis][b].count;
+            }
+        }
+    }
+};
+
+struct BuildNode {
+    BoundingBox bounds;
+    uint32_t left = 0;  // right child is left + 1
+    uint32_t first = 0;
+    uint32_t count = 0; // 0 for interior nodes
+};
+
+float surfaceArea(const BoundingBox& box) {
+    if (box.isEmpty())
+        return 0.0f;
+    glm::vec3 d = box.max - box.min;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+class Builder {
+public:
+    Builder(const std::vector<BoundingBox>& bounds, std::vector<uint32_t>& indices)
+        : primitiveBounds(bounds), primitiveIndices(indices) {
+        centroids.resize(bounds.size());
+        parallelFor(bounds.size(), 1 << 16, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                centroids[i] = bounds[i].center();
+        });
+        buildNodes.resize(std::max<size_t>(2 * bounds.size(), 1));
+
+        unsigned workers = workerCount();
+        while ((1u << parallelDepth) < workers)
+            ++parallelDepth;
+        ++parallelDepth;
+    }
+
+    void run() {
+        BoundingBox bounds, centroidBounds;
+        for (size_t i = 0; i < primitiveBounds.size(); ++i) {
+            expandBounds(bounds, primitiveBounds[i]);
+            expandBounds(centroidBounds, centroids[i]);
+        }
+        buildNode(0, 0, static_cast<uint32_t>(primitiveBounds.size()), bounds, centroidBounds, 0);
+    }
+
+    void flatten(std::vector<BvhNode>& nodes) const {
+        nodes.clear();
+        nodes.reserve(nodeCount.load());
+        flattenNode(0, nodes);
+    }
+
+private:
+    const std::vector<BoundingBox>& primitiveBounds;
+    std::vector<uint32_t>& primitiveIndices;
+    std::vector<glm::vec3> centroids;
+    std::vector<BuildNode> buildNodes;
+    std::atomic<uint32_t> nodeCount{1};
+    int parallelDepth = 0;
+
+    int binOf(const glm::vec3& centroid, int axis, const BoundingBox& centroidBounds, float scale) const {
+        int bin = static_cast<int>((centroid[axis] - centroidBounds.min[axis]) * scale);
+        return std::min(std::max(bin, 0), kBinCount - 1);
+    }
+
+    void binRange(uint32_t begin, uint32_t end, const BoundingBox& centroidBounds, const glm::vec3& scale, AxisBins& out) const {
+        for (uint32_t i = begin; i < end; ++i) {
+            uint32_t primitive = primitiveIndices[i];
+            const glm::vec3& centroid = centroids[primitive];
+            for (int axis = 0; axis < 3; ++axis) {
+                Bin& bin = out.bins[axis][binOf(centroid, axis, centroidBounds, scale[axis])];
+                expandBounds(bin.bounds, primitiveBounds[primitive]);
+                expandBounds(bin.centroidBounds, centroid);
+                ++bin.count;
+            }
+        }
+    }
+
+    void makeLeaf(uint32_t index, uint32_t first, uint32_t count, const BoundingBox& bounds) {
+        BuildNode& node = buildNodes[index];
+        node.bounds = bounds;
+        node.first = first;
+        node.count = count;
+    }
+
+    void buildNode(uint32_t index, uint32_t first, uint32_t count,
+                   const BoundingBox& bounds, const BoundingBox& centroidBounds, int depth) {
+        if (count <= 2 || depth >= kMaxDepth) {
+            makeLeaf(index, first, count, bounds);
+            return;
+        }
+
+        glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+        glm::vec3 scale;
+        for (int axis = 0; axis < 3; ++axis)
+            scale[axis] = extent[axis] > 0.0f ? kBinCount / extent[axis] : 0.0f;
+
+        AxisBins bins;
+        if (count >= kParallelBinning && depth < parallelDepth) {
+            std::mutex mergeMutex;
+            parallelFor(count, kParallelBinning / 4, [&](size_t begin, size_t end) {
+                AxisBins local;
+                binRange(first + static_cast<uint32_t>(begin), first + static_cast<uint32_t>(end), centroidBounds, scale, local);
+                std::lock_guard<std::mutex> lock(mergeMutex);
+                bins.merge(local);
+            });
+        } else {
+            binRange(first, first + count, centroidBounds, scale, bins);
+        }
+
+        // Sweep each axis to find the cheapest plane between bins
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1, bestSplit = 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (scale[axis] == 0.0f)
+                continue;
+
+            float rightArea[kBinCount];
+            uint32_t rightCount[kBinCount];
+            BoundingBox accumulated;
+            uint32_t accumulatedCount = 0;
+            for (int b = kBinCount - 1; b > 0; --b) {
+                expandBounds(accumulated, bins.bins[axis][b].bounds);
+                accumulatedCount += bins.bins[axis][b].count;
+                rightArea[b] = surfaceArea(accumulated);
+                rightCount[b] = accumulatedCount;
+            }
+
+            accumulated = BoundingBox();
+            accumulatedCount = 0;
+            for (int split = 1; split < kBinCount; ++split) {
+                expandBounds(accumulated, bins.bins[axis][split - 1].bounds);
+                accumulatedCount += bins.bins[axis][split - 1].count;
+                if (accumulatedCount == 0 || rightCount[split] == 0)
+                    continue;
+                float cost = surfaceArea(accumulated) * accumulatedCount + rightArea[split] * rightCount[split];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+
+        // Traversal step costs about as much as one primitive test
+        float area = surfaceArea(bounds);
+        float splitCost = 1.0f + (area > 0.0f ? bestCost / area : 0.0f);
+        if (bestAxis < 0 || (splitCost >= static_cast<float>(count) && count <= kMaxLeafSize)) {
+            if (bestAxis < 0 && count > kMaxLeafSize) {
+                // All centroids coincide: split in the middle to keep leaves small
+                splitMiddle(index, first, count, bounds, depth);
+                return;
+            }
+            makeLeaf(index, first, count, bounds);
+            return;
+        }
+
+        // Partition primitives in place by the chosen plane
+        uint32_t* begin = primitiveIndices.data() + first;
+        uint32_t* end = begin + count;
+        float axisScale = scale[bestAxis];
+        uint32_t* middle = std::partition(begin, end, [&](uint32_t primitive) {
+            return binOf(centroids[primitive], bestAxis, centroidBounds, axisScale) < bestSplit;
+        });
+        uint32_t leftCount = static_cast<uint32_t>(middle - begin);
+
+        BoundingBox leftBounds, leftCentroids, rightBounds, rightCentroids;
+        for (int b = 0; b < kBinCount; ++b) {
+            const Bin& bin = bins.bins[bestAxis][b];
+            if (b < bestSplit) {
+                expandBounds(leftBounds, bin.bounds);
+                expandBounds(leftCentroids, bin.centroidBounds);
+            } else {
+                expandBounds(rightBounds, bin.bounds);
+                expandBounds(rightCentroids, bin.centroidBounds);
+            }
+        }
+
+        uint32_t left = nodeCount.fetch_add(2);
+        buildNodes[index].bounds = bounds;
+        buildNodes[index].left = left;
+        buildNodes[index].count = 0;
+
+        buildChildren(left, first, leftCount, leftBounds, leftCentroids,
+                      first + leftCount, count - leftCount, rightBounds, rightCentroids, depth);
+    }
+
+    void splitMiddle(uint32_t index, uint32_t first, uint32_t count, const BoundingBox& bounds, int depth) {
+        uint32_t leftCount = count / 2;
+        BoundingBox leftBounds, leftCentroids, rightBounds, rightCentroids;
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t primitive = primitiveIndices[first + i];
+            BoundingBox& box = i < leftCount ? leftBounds : rightBounds;
+            BoundingBox& centroidBox = i < leftCount ? leftCentroids : rightCentroids;
+            expandBounds(box, primitiveBounds[primitive]);
+            expandBounds(centroidBox, centroids[primitive]);
+        }
+
+        uint32_t left = nodeCount.fetch_add(2);
+        buildNodes[index].bounds = bounds;
+        buildNodes[index].left = left;
+        buildNodes[index].count = 0;
+
+        buildChildren(left, first, leftCount, leftBounds, leftCentroids,
+                      first + leftCount, count - leftCount, rightBounds, rightCentroids, depth);
+    }
+
+    void buildChildren(uint32_t left, uint32_t leftFirst, uint32_t leftCount,
+                       const BoundingBox& leftBounds, const BoundingBox& leftCentroids,
+                       uint32_t rightFirst, uint32_t rightCount,
+                       const BoundingBox& rightBounds, const BoundingBox& rightCentroids, int depth) {
+        // Children cover disjoint index ranges and node slots, so they can build concurrently
+        if (depth < parallelDepth && std::min(leftCount, rightCount) >= kParallelSubtree) {
+            auto leftTask = std::async(std::launch::async, [&] {
+                buildNode(left, leftFirst, leftCount, leftBounds, leftCentroids, depth + 1);
+            });
+            buildNode(left + 1, rightFirst, rightCount, rightBounds, rightCentroids, depth + 1);
+            leftTask.get();
+        } else {
+            buildNode(left, leftFirst, leftCount, leftBounds, leftCentroids, depth + 1);
+            buildNode(left + 1, rightFirst, rightCount, rightBounds, rightCentroids, depth + 1);
+        }
+    }
+
+    uint32_t flattenNode(uint32_t index, std::vector<BvhNode>& nodes) const {
+        const BuildNode& node = buildNodes[index];
+        uint32_t flatIndex = static_cast<uint32_t>(nodes.size());
+        nodes.push_back({ node.bounds.min, node.first, node.bounds.max, node.count });
+
+        if (node.count == 0) {
+            flattenNode(node.left, nodes);
+            uint32_t right = flattenNode(node.left + 1, nodes);
+            nodes[flatIndex].rightOrFirst = right;
+        }
+        return flatIndex;
+    }
+};
+
+// Möller-Trumbore, returns the distance along the ray or a negative value on a miss
+float intersectTriangle(const Ray& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& u, float& v) {
+    glm::vec3 edge1 = v1 - v0;
+    glm::vec3 edge2 = v2 - v0;
+    glm::vec3 p = glm::cross(ray.direction, edge2);
+    float det = glm::dot(edge1, p);
+    if (std::abs(det) < 1e-12f)
+        return -1.0f;
+
+    float invDet = 1.0f / det;
+    glm::vec3 s = ray.origin - v0;
+    u = glm::dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f)
+        return -1.0f;
+
+    glm::vec3 q = glm::cross(s, edge1);
+    v = glm::dot(ray.direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f)
+        return -1.0f;
+
+    return glm::dot(edge2, q) * invDet;
+}
+
+}
+
+void Bvh::build(const std::vector<BoundingBox>& primitiveBounds) {
+    clear();
+    if (primitiveBounds.empty())
+        return;
+
+    primitiveIndices.resize(primitiveBounds.size());
+    for (uint32_t i = 0; i < primitiveIndices.size(); ++i)
+        primitiveIndices[i] = i;
+
+    Builder builder(primitiveBounds, primitiveIndices);
+    builder.run();
+    builder.flatten(nodes);
+}
+
+void Bvh::clear() {
+    nodes.clear();
+    primitiveIndices.clear();
+}
+
+void TriangleBvh::build(const Mesh& mesh) {
+    const std::vector<Vertex>& vertices = mesh.getVertices();
+    const std::vector<GLuint>& indices = mesh.getIndices();
+    size_t triangleCount = indices.size() / 3;
+
+    std::vector<BoundingBox> triangleBounds(triangleCount);
+    parallelFor(triangleCount, 1 << 16, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            BoundingBox box;
+            for (int k = 0; k < 3; ++k)
+                expandBounds(box, vertices[indices[3 * t + k]].position);
+            triangleBounds[t] = box;
+        }
+    });
+
+    bvh.build(triangleBounds);
+    bounds = mesh.getBounds();
+
+    // Store corners in leaf order so intersecting a leaf reads one contiguous run
+    const std::vector<uint32_t>& order = bvh.getPrimitiveIndices();
+    triangleIds = order;
+    corners.resize(order.size() * 3);
+    parallelFor(order.size(), 1 << 16, [&](size_t begin, size_t end) {
+        for (size_t slot = begin; slot < end; ++slot) {
+            for (int k = 0; k < 3; ++k)
+                corners[3 * slot + k] = vertices[indices[3 * order[slot] + k]].position;
+        }
+    });
+}
+
+bool TriangleBvh::intersect(const Ray& ray, RayHit& hit) const {
+    bool found = false;
+    float tMax = hit.distance;
+    bvh.traverse(ray, tMax, [&](uint32_t slot, float& limit) {
+        float u, v;
+        float t = intersectTriangle(ray, corners[3 * slot], corners[3 * slot + 1], corners[3 * slot + 2], u, v);
+        if (t >= 0.0f && t < limit) {
+            limit = t;
+            hit.triangle = triangleIds[slot];
+            hit.distance = t;
+            hit.u = u;
+            hit.v = v;
+            found = true;
+        }
+    });
+    return found;
+}
@@ -0,0 +1,142 @@
+//
+//  bvh.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/7/25.
+//
+
+#ifndef bvh_hpp
+#define bvh_hpp
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "bounds.hpp"
+
+class Mesh;
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction; // not required to be normalized, hit distances are in its units
+};
+
+// 32 bytes, flattened depth-first: an interior node's left child is the next node and
+// rightOrFirst holds the right child; a leaf has count > 0 primitives starting at rightOrFirst
+struct BvhNode {
+    glm::vec3 boundsMin;
+    uint32_t rightOrFirst;
+    glm::vec3 boundsMax;
+    uint32_t count;
+};
+
+// Bounding volume hierarchy over arbitrary primitive bounds, built top-down with a binned
+// surface area heuristic. Large nodes are binned in parallel and large subtrees are built
+// on separate threads.
+class Bvh {
+public:
+    void build(const std::vector<BoundingBox>& primitiveBounds);
+    void clear();
+
+    bool isEmpty() const { return nodes.empty(); }
+    const std::vector<BvhNode>& getNodes() const { return nodes; }
+    const std::vector<uint32_t>& getPrimitiveIndices() const { return primitiveIndices; }
+
+    // Calls hit(leafSlot, tMax) for each primitive slot in every leaf the ray reaches before tMax,
+    // nearer children first; hit() may shrink tMax. getPrimitiveIndices()[leafSlot] is the primitive.
+    template <typename HitFunction>
+    void traverse(const Ray& ray, float& tMax, HitFunction&& hit) const;
+
+private:
+    std::vector<BvhNode> nodes;
+    std::vector<uint32_t> primitiveIndices;
+};
+
+struct RayHit {
+    uint32_t triangle = std::numeric_limits<uint32_t>::max(); // index into the mesh's indices / 3
+    float distance = std::numeric_limits<float>::max();
+    float u = 0.0f, v = 0.0f;                                 // barycentrics of vertices 1 and 2
+
+    bool isHit() const { return triangle != std::numeric_limits<uint32_t>::max(); }
+};
+
+// Triangle BVH for one mesh in its local space. Triangle corners are copied in leaf order
+// so a leaf's triangles are contiguous in memory.
+class TriangleBvh {
+public:
+    void build(const Mesh& mesh);
+    // Keeps hit.distance as the upper bound, so several meshes can share one RayHit
+    bool intersect(const Ray& ray, RayHit& hit) const;
+
+    const BoundingBox& getBounds() const { return bounds; }
+    size_t getTriangleCount() const { return triangleIds.size(); }
+
+private:
+    Bvh bvh;
+    std::vector<glm::vec3> corners;    // 3 per triangle, in BVH leaf order
+    std::vector<uint32_t> triangleIds; // original triangle index per leaf slot
+    BoundingBox bounds;
+};
+
+template <typename HitFunction>
+void Bvh::traverse(const Ray& ray, float& tMax, HitFunction&& hit) const {
+    if (nodes.empty())
+        return;
+
+    glm::vec3 invDir(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+
+    // Returns the entry distance, or infinity when the slab test misses
+    auto enter = [&](const BvhNode& node) {
+        glm::vec3 t0 = (node.boundsMin - ray.origin) * invDir;
+        glm::vec3 t1 = (node.boundsMax - ray.origin) * invDir;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+        return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+    };
+
+    uint32_t stack[64];
+    int stackSize = 0;
+    uint32_t current = 0;
+    if (enter(nodes[0]) == std::numeric_limits<float>::infinity())
+        return;
+
+    for (;;) {
+        const BvhNode& node = nodes[current];
+        if (node.count > 0) {
+            for (uint32_t i = 0; i < node.count; ++i)
+                hit(node.rightOrFirst + i, tMax);
+        } else {
+            uint32_t left = current + 1, right = node.rightOrFirst;
+            float tLeft = enter(nodes[left]);
+            float tRight = enter(nodes[right]);
+            if (tLeft > tRight) {
+                std::swap(left, right);
+                std::swap(tLeft, tRight);
+            }
+            if (tLeft != std::numeric_limits<float>::infinity()) {
+                // The builder caps the depth, so the stack cannot overflow
+                if (tRight != std::numeric_limits<float>::infinity())
+                    stack[stackSize++] = right;
+                current = left;
+                continue;
+            }
+        }
+
+        // Pop, skipping nodes that the shrunken tMax now rules out
+        for (;;) {
+            if (stackSize == 0)
+                return;
+            current = stack[--stackSize];
+            if (enter(nodes[current]) != std::numeric_limits<float>::infinity())
+                break;
+        }
+    }
+}
+
+#endif /* bvh_hpp */
@@ -9,22 +9,39 @@
 #include <glm/glm.hpp> 
 #include <glm/gtc/type_ptr.hpp>
 #include <GLFW/glfw3.h>
+#include <cassert>
 #include <cmath>
 #include <algorithm>
 
 Camera::Camera()
     : eye(0.0, 0.0, 30.0), ref(0.0), up(0.0, 1.0, 0.0),
       xmin(-5), xmax(5), ymin(-5), ymax(5), zmin(-10), zmax(10),
-      preserveAspect(true), projectionType(ProjectionType::Perspective) {}
+      preserveAspect(true), projectionType(ProjectionType::Perspective),
+      baseOffset(eye - ref), baseUp(up) {}
 
 void Camera::setProjectionType(ProjectionType type)
 {
     projectionType = type;
+    projectionDirty = true;
+}
+
+void Camera::setClipControlSupported(bool supported)
+{
+    if (supported == clipControlSupported)
+        return;
+    clipControlSupported = supported;
+    projectionDirty = true;
+}
+
+bool Camera::isReversedZ() const
+{
+    return projectionType == ProjectionType::ReversedZ && clipControlSupported;
 }
 
 void Camera::setPreserveAspect(bool preserve)
 {
     preserveAspect = preserve;
+    projectionDirty = true;
 }
 
 void Camera::setLimits(double xMin, double xMax, double yMin, double yMax, double zMin, double zMax)
@@ -35,6 +52,7 @@ void Camera::setLimits(double xMin, double xMax, double yMin, double yMax, doubl
     ymax = yMax;
     zmin = zMin;
     zmax = zMax;
+    projectionDirty = true;
 }
 
 void Camera::setScale(double limit)
@@ -42,11 +60,25 @@ void Camera::setScale(double limit)
     setLimits(-limit, limit, -limit, limit, -2 * limit, 2 * limit);
 }
 
-void Camera::lookAt(const glm::vec3 &eyePos, const glm::vec3 &target, const glm::vec3 &upVec)
+void Camera::copyLimits(const Camera &other)
+{
+    if (xmin == other.xmin && xmax == other.xmax && ymin == other.ymin && ymax == other.ymax
+        && zmin == other.zmin && zmax == other.zmax)
+        return;
+    setLimits(other.xmin, other.xmax, other.ymin, other.ymax, other.zmin, other.zmax);
+}
+
+void Camera::lookAt(const glm::dvec3 &eyePos, const glm::dvec3 &target, const glm::dvec3 &upVec)
 {
     eye = eyePos;
     ref = target;
     up = upVec;
+    baseOffset = eye - ref;
+    baseUp = up;
+    arcballRotation = glm::dquat(1.0, 0.0, 0.0, 0.0);
+    // The view distance feeds the projection's near/far and fovY
+    viewDirty = true;
+    projectionDirty = true;
 }
 
 void Camera::setDragging(bool dragging)
@@ -54,61 +86,268 @@ void Camera::setDragging(bool dragging)
     this->dragging = dragging;
 }
 
-void Camera::apply(GLuint shaderProgram)
+void Camera::publishState(const CameraState &state)
+{
+    publishedState.write(state);
+}
+
+CameraState Camera::getState() const
+{
+    CameraState state;
+    state.eye = eye;
+    state.ref = ref;
+    state.up = up;
+    return state;
+}
+
+void Camera::consumePublishedState()
+{
+    if (!publishedState.consume())
+        return;
+
+    const CameraState &state = publishedState.readBuffer();
+    lookAt(state.eye, state.ref, state.up);
+    // Drop a cursor move that was queued against the old placement
+    hasPendingMove = false;
+}
+
+void Camera::setViewport(int width, int height)
+{
+    if (width == viewportWidth && height == viewportHeight)
+        return;
+    viewportWidth = width;
+    viewportHeight = height;
+    projectionDirty = true;
+}
+
+const glm::mat4 &Camera::getProjectionMatrix() const
+{
+    updateMatrices();
+    return projection;
+}
+
+const glm::mat4 &Camera::getViewMatrix() const
+{
+    updateMatrices();
+    return view;
+}
+
+const glm::mat4 &Camera::getViewProjectionMatrix() const
+{
+    updateMatrices();
+    return viewProjection;
+}
+
+const Frustum &Camera::getFrustum() const
+{
+    updateMatrices();
+    return frustum;
+}
+
+// Translate(-eye) * model, by moving only the translation column: exact when the model is
+// affine (bottom row 0 0 0 1), which every scene transform here is
+glm::dmat4 Camera::toCameraRelative(const glm::dmat4 &model) const
+{
+    assert(model[0][3] == 0.0 && model[1][3] == 0.0 && model[2][3] == 0.0 && model[3][3] == 1.0);
+    glm::dmat4 relative = model;
+    relative[3] -= glm::dvec4(eye, 0.0);
+    return relative;
+}
+
+glm::mat4 Camera::getRelativeModelMatrix(const glm::dmat4 &model) const
+{
+    return glm::mat4(toCameraRelative(model));
+}
+
+glm::mat4 Camera::getModelViewMatrix(const glm::dmat4 &model) const
+{
+    updateMatrices();
+    return glm::mat4(rotationD * toCameraRelative(model));
+}
+
+glm::mat4 Camera::getModelViewProjectionMatrix(const glm::dmat4 &model) const
+{
+    updateMatrices();
+    return glm::mat4(projectionD * rotationD * toCameraRelative(model));
+}
+
+double Camera::getPixelsPerUnit(double distance) const
 {
-    int width, height;
-    glfwGetFramebufferSize(glfwGetCurrentContext(), &width, &height);
+    updateMatrices();
+
+    // projection[1][1] is 1 / tan(fovY / 2), or 2 / (ymax - ymin) for orthographic views,
+    // after preserveAspect widened the limits
+    double scale = 0.5 * std::max(viewportHeight, 1) * projectionD[1][1];
+    if (projectionType == ProjectionType::Orthographic)
+        return scale;
+    return scale / std::max(distance, 1e-6);
+}
+
+void Camera::screenToRay(double x, double y, glm::dvec3 &origin, glm::dvec3 &direction) const
+{
+    updateMatrices();
+
+    int width = std::max(viewportWidth, 1);
+    int height = std::max(viewportHeight, 1);
+    double ndcX = 2.0 * (x + 0.5) / width - 1.0;
+    double ndcY = 1.0 - 2.0 * (y + 0.5) / height;
 
-    double xMin = xmin, xMax = xmax, yMin = ymin, yMax = ymax;
-    if (preserveAspect)
+    // Reversed-Z puts the near plane at depth 1 and infinity at 0, so unproject near and mid depths
+    double nearDepth = isReversedZ() ? 1.0 : -1.0;
+    double farDepth = isReversedZ() ? 0.5 : 0.0;
+
+    glm::dmat4 inverse = glm::inverse(projectionD * rotationD);
+    glm::dvec4 nearPoint = inverse * glm::dvec4(ndcX, ndcY, nearDepth, 1.0);
+    glm::dvec4 farPoint = inverse * glm::dvec4(ndcX, ndcY, farDepth, 1.0);
+    glm::dvec3 nearPosition = glm::dvec3(nearPoint) / nearPoint.w;
+    glm::dvec3 farPosition = glm::dvec3(farPoint) / farPoint.w;
+
+    origin = eye + nearPosition;
+    direction = glm::normalize(farPosition - nearPosition);
+}
+
+void Camera::updateMatrices() const
+{
+    if (!projectionDirty && !viewDirty)
+        return;
+
+    // Minimized windows report a 0x0 framebuffer
+    int width = std::max(viewportWidth, 1);
+    int height = std::max(viewportHeight, 1);
+
+    double viewDist = glm::length(eye - ref);
+
+    if (projectionDirty)
     {
-        double aspect = static_cast<double>(height) / width;
-        double desired = (ymax - ymin) / (xmax - xmin);
+        double xMin = xmin, xMax = xmax, yMin = ymin, yMax = ymax;
+        if (preserveAspect)
+        {
+            double aspect = static_cast<double>(height) / width;
+            double desired = (ymax - ymin) / (xmax - xmin);
+
+            if (desired > aspect)
+            {
+                double extra = ((desired / aspect) - 1.0) * (xMax - xMin) / 2.0;
+                xMin -= extra;
+                xMax += extra;
+            }
+            else
+            {
+                double extra = ((aspect / desired) - 1.0) * (yMax - yMin) / 2.0;
+                yMin -= extra;
+                yMax += extra;
+            }
+        }
 
-        if (desired > aspect)
+        if (projectionType == ProjectionType::Orthographic)
         {
-            double extra = ((desired / aspect) - 1.0) * (xMax - xMin) / 2.0;
-            xMin -= extra;
-            xMax += extra;
+            projection = glm::ortho(static_cast<float>(xMin), static_cast<float>(xMax),
+                                    static_cast<float>(yMin), static_cast<float>(yMax),
+                                    static_cast<float>(viewDist - zmax), static_cast<float>(viewDist - zmin));
         }
         else
         {
-            double extra = ((aspect / desired) - 1.0) * (yMax - yMin) / 2.0;
-            yMin -= extra;
-            yMax += extra;
+            double near = std::max(viewDist - zmax, 0.1);
+            double fovY = glm::degrees(2.0 * atan((yMax - yMin) / (2.0 * viewDist)));
+            double aspect = static_cast<double>(width) / height;
+
+            if (projectionType == ProjectionType::Perspective)
+            {
+                projection = glm::perspective(glm::radians(static_cast<float>(fovY)), static_cast<float>(aspect),
+                                              static_cast<float>(near), static_cast<float>(viewDist - zmin));
+            }
+            else if (clipControlSupported)
+            {
+                // Maps near to depth 1 and infinity to depth 0 under GL_ZERO_TO_ONE, so
+                // float depth precision is spent where the distances are large
+                double f = 1.0 / tan(glm::radians(fovY) / 2.0);
+                projection = glm::mat4(0.0f);
+                projection[0][0] = static_cast<float>(f / aspect);
+                projection[1][1] = static_cast<float>(f);
+                projection[2][3] = -1.0f;
+                projection[3][2] = static_cast<float>(near);
+            }
+            else
+            {
+                projection = glm::infinitePerspective(glm::radians(static_cast<float>(fovY)), static_cast<float>(aspect),
+                                                      static_cast<float>(near));
+            }
         }
     }
 
-    double viewDist = glm::length(eye - ref);
+    // The view only rotates: translation by -eye is folded into each model matrix in double
+    if (viewDirty)
+    {
+        rotationD = glm::lookAt(glm::dvec3(0.0), ref - eye, up);
+        view = glm::mat4(rotationD);
+    }
 
-    glm::mat4 projection;
-    if (projectionType == ProjectionType::Orthographic)
+    projectionD = glm::dmat4(projection);
+    viewProjection = projection * view;
+    frustum = extractFrustum(viewProjection, isReversedZ() ? ClipDepth::ReversedZeroToOne : ClipDepth::NegativeOneToOne);
+    projectionDirty = false;
+    viewDirty = false;
+    ++matrixVersion;
+}
+
+void Camera::apply()
+{
+    if (viewportWidth == 0 && viewportHeight == 0)
+    {
+        int width, height;
+        glfwGetFramebufferSize(glfwGetCurrentContext(), &width, &height);
+        setViewport(width, height);
+    }
+
+    updateMatrices();
+
+    if (uniformBuffer == 0)
     {
-        projection = glm::ortho(static_cast<float>(xMin), static_cast<float>(xMax),
-                                static_cast<float>(yMin), static_cast<float>(yMax),
-                                static_cast<float>(viewDist - zmax), static_cast<float>(viewDist - zmin));
+        glGenBuffers(1, &uniformBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraUniforms), nullptr, GL_DYNAMIC_DRAW);
     }
-    else
+
+    if (uploadedVersion != matrixVersion)
     {
-        double near = std::max(viewDist - zmax, 0.1);
-        double fovY = glm::degrees(2.0 * atan((yMax - yMin) / (2.0 * viewDist)));
-        double aspect = static_cast<double>(width) / height;
-        projection = glm::perspective(glm::radians(static_cast<float>(fovY)), static_cast<float>(aspect),
-                                      static_cast<float>(near), static_cast<float>(viewDist - zmin));
+        float width = static_cast<float>(std::max(viewportWidth, 1));
+        float height = static_cast<float>(std::max(viewportHeight, 1));
+
+        CameraUniforms uniforms;
+        uniforms.view = view;
+        uniforms.projection = projection;
+        uniforms.viewProjection = viewProjection;
+        uniforms.inverseView = glm::inverse(view);
+        uniforms.inverseProjection = glm::inverse(projection);
+        uniforms.inverseViewProjection = glm::inverse(viewProjection);
+        uniforms.eyePosition = glm::vec4(glm::vec3(eye), 1.0f);
+        uniforms.viewport = glm::vec4(width, height, 1.0f / width, 1.0f / height);
+
+        glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraUniforms), &uniforms);
+        uploadedVersion = matrixVersion;
     }
 
-    glm::mat4 view = glm::lookAt(eye, ref, up);
+    glBindBufferBase(GL_UNIFORM_BUFFER, kUniformBinding, uniformBuffer);
+}
+
+void Camera::cleanup()
+{
+    glDeleteBuffers(1, &uniformBuffer);
+    uniformBuffer = 0;
+    uploadedVersion = 0;
+}
 
-    glUseProgram(shaderProgram);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "uProjection"), 1, GL_FALSE, glm::value_ptr(projection));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "uView"), 1, GL_FALSE, glm::value_ptr(view));
+void Camera::bindUniformBlock(GLuint shaderProgram)
+{
+    GLuint blockIndex = glGetUniformBlockIndex(shaderProgram, "CameraBlock");
+    if (blockIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(shaderProgram, blockIndex, kUniformBinding);
 }
 
 glm::vec3 Camera::screenToArcball(int x, int y)
 {
-    int width, height;
-    glfwGetFramebufferSize(glfwGetCurrentContext(), &width, &height);
-    float cx = width / 2.0f, cy = height / 2.0f;
+    float cx = std::max(viewportWidth, 1) / 2.0f, cy = std::max(viewportHeight, 1) / 2.0f;
     float scale = 0.8f * std::min(cx, cy);
     float dx = (x - cx);
     float dy = (cy - y);
@@ -121,6 +360,7 @@ glm::vec3 Camera::screenToArcball(int x, int y)
 void Camera::onMouseDown(int x, int y)
 {
     dragging = true;
+    hasPendingMove = false;
     prevRay = screenToArcball(x, y);
 }
 
@@ -128,7 +368,22 @@ void Camera::onMouseMove(int x, int y)
 {
     if (!dragging)
         return;
-    glm::vec3 currRay = screenToArcball(x, y);
+    pendingX = x;
+    pendingY = y;
+    hasPendingMove = true;
+}
+
+void Camera::update()
+{
+    consumePublishedState();
+
+    if (!hasPendingMove)
+        return;
+    hasPendingMove = false;
+    if (!dragging)
+        return;
+
+    glm::vec3 currRay = screenToArcball(pendingX, pendingY);
     applyArcballRotation(prevRay, currRay);
     prevRay = currRay;
 }
@@ -136,13 +391,14 @@ void Camera::onMouseMove(int x, int y)
 void Camera::applyArcballRotation(const glm::vec3 &from, const glm::vec3 &to)
 {
     glm::vec3 axis = glm::cross(from, to);
-    float angle = acosf(glm::dot(from, to));
     if (glm::length(axis) < 0.0001f)
         return;
 
-    glm::mat4 rot = glm::rotate(glm::mat4(1.0f), angle, axis);
-    glm::vec4 newDir = rot * glm::vec4(eye - ref, 0.0f);
-    glm::vec4 newUp = rot * glm::vec4(up, 0.0f);
-    eye = ref + glm::vec3(newDir);
-    up = glm::normalize(glm::vec3(newUp));
+    // Shortest-arc quaternion between two unit vectors, no acos or matrix build needed
+    glm::quat rot = glm::normalize(glm::quat(1.0f + glm::dot(from, to), axis));
+    arcballRotation = glm::normalize(glm::dquat(rot) * arcballRotation);
+
+    eye = ref + arcballRotation * baseOffset;
+    up = arcballRotation * baseUp;
+    viewDirty = true;
 }
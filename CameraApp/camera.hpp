@@ -14,6 +14,32 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "culling.hpp"
+#include "triple_buffer.hpp"
+
+// Mirrors the std140 "CameraBlock" uniform block shared by every shader program.
+// Render space is camera-relative: the view matrix only rotates, the eye sits at the origin.
+struct CameraUniforms
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::mat4 inverseView;
+    glm::mat4 inverseProjection;
+    glm::mat4 inverseViewProjection;
+    glm::vec4 eyePosition; // world-space eye, rounded to float
+    glm::vec4 viewport; // width, height, 1 / width, 1 / height
+};
+
+// Camera placement snapshot exchanged between an input/simulation thread and the render thread
+struct CameraState
+{
+    glm::dvec3 eye = glm::dvec3(0.0, 0.0, 30.0);
+    glm::dvec3 ref = glm::dvec3(0.0);
+    glm::dvec3 up = glm::dvec3(0.0, 1.0, 0.0);
+};
 
 class Camera
 {
@@ -21,32 +47,98 @@ public:
     enum class ProjectionType
     {
         Perspective,
-        Orthographic
+        Orthographic,
+        ReversedZ       // Perspective with an infinite far plane and reversed depth
     };
 
+    static constexpr GLuint kUniformBinding = 0;
+
     Camera();
 
-    void apply(GLuint shaderProgram);
+    // Writes the camera uniform buffer (only when it changed) and binds it to kUniformBinding
+    void apply();
+    void cleanup();
+
+    // Points a program's "CameraBlock" at kUniformBinding; call once after linking
+    static void bindUniformBlock(GLuint shaderProgram);
 
     void setProjectionType(ProjectionType type);
+    ProjectionType getProjectionType() const { return projectionType; }
+    // Without glClipControl the ReversedZ type falls back to a standard infinite-far projection
+    void setClipControlSupported(bool supported);
+    bool isReversedZ() const;
     void setPreserveAspect(bool preserve);
     void setLimits(double xmin, double xmax, double ymin, double ymax, double zmin, double zmax);
     void setScale(double limit);
-    void lookAt(const glm::vec3 &eye, const glm::vec3 &target, const glm::vec3 &up);
+    // Takes another camera's view window and depth range, so both frame the same extent
+    void copyLimits(const Camera &other);
+    void lookAt(const glm::dvec3 &eye, const glm::dvec3 &target, const glm::dvec3 &up);
+    const glm::dvec3 &getEyePosition() const { return eye; }
     void setDragging(bool dragging);
 
+    // Lock-free, safe to call from one thread other than the render thread. The latest
+    // published state replaces eye/ref/up at the next update(), so every pass of a frame sees
+    // the same placement.
+    void publishState(const CameraState &state);
+    CameraState getState() const;
+    void setViewport(int width, int height);
+
+    // Cached camera-relative matrices, rebuilt lazily after the camera or viewport changes
+    const glm::mat4 &getProjectionMatrix() const;
+    const glm::mat4 &getViewMatrix() const;
+    const glm::mat4 &getViewProjectionMatrix() const;
+    const Frustum &getFrustum() const;
+
+    // Composes a double-precision world transform with the camera on the CPU, so only
+    // small camera-relative values are rounded to float. The model must be affine.
+    glm::mat4 getRelativeModelMatrix(const glm::dmat4 &model) const;
+    glm::mat4 getModelViewMatrix(const glm::dmat4 &model) const;
+    glm::mat4 getModelViewProjectionMatrix(const glm::dmat4 &model) const;
+    int getViewportWidth() const { return viewportWidth; }
+    int getViewportHeight() const { return viewportHeight; }
+    // Framebuffer pixels covered by one world unit at the given distance from the eye: the
+    // viewport height over the view volume height there (2 * distance * tan(fovY / 2), with fovY
+    // set by the y limits at viewDist). Orthographic views ignore the distance.
+    double getPixelsPerUnit(double distance) const;
+    // World-space ray through a framebuffer pixel (top-left origin), starting on the near plane
+    void screenToRay(double x, double y, glm::dvec3 &origin, glm::dvec3 &direction) const;
+
     void onMouseDown(int x, int y);
+    // Only records the cursor, update() folds all moves of a frame into one rotation
     void onMouseMove(int x, int y);
+    void update();
 
 private:
-    glm::vec3 eye, ref, up;
+    glm::dvec3 eye, ref, up;
     double xmin, xmax, ymin, ymax, zmin, zmax;
     bool preserveAspect;
     ProjectionType projectionType;
+    bool clipControlSupported = false;
+    int viewportWidth = 0, viewportHeight = 0;
 
     bool dragging = false;
     glm::vec3 prevRay;
+    bool hasPendingMove = false;
+    int pendingX = 0, pendingY = 0;
+
+    TripleBuffer<CameraState> publishedState;
+
+    // Accumulated arcball orientation applied to the eye offset and up vector given to lookAt
+    glm::dquat arcballRotation = glm::dquat(1.0, 0.0, 0.0, 0.0);
+    glm::dvec3 baseOffset, baseUp;
+
+    mutable glm::mat4 projection, view, viewProjection;
+    mutable glm::dmat4 projectionD, rotationD;
+    mutable Frustum frustum;
+    mutable bool projectionDirty = true, viewDirty = true;
+    mutable unsigned matrixVersion = 0;
+
+    GLuint uniformBuffer = 0;
+    unsigned uploadedVersion = 0;
 
+    void consumePublishedState();
+    glm::dmat4 toCameraRelative(const glm::dmat4 &model) const;
+    void updateMatrices() const;
     glm::vec3 screenToArcball(int x, int y);
     void applyArcballRotation(const glm::vec3 &from, const glm::vec3 &to);
 };
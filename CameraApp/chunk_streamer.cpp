@@ -0,0 +1,333 @@
+//
+//  chunk_streamer.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/26/25.
+//
+
+#include "chunk_streamer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+// Chunks behind the camera still count, at a discount, so turning around finds most of them resident
+constexpr double kOffscreenWeight = 0.25;
+// Exponential smoothing of the per-frame eye motion, so one jittery frame does not redirect prefetch
+constexpr double kVelocitySmoothing = 0.2;
+// Resident chunks are held to the arena size over this: size classes round allocations up and
+// evicted ranges wait for their fence, neither should refuse chunks the budget admits
+constexpr double kArenaHeadroom = 1.25;
+// Frames an evicted range can take to come back through the arena's fences
+constexpr uint64_t kFramesInFlight = 4;
+
+}
+
+bool ChunkStreamer::open(const std::string& filePath, size_t budgetBytes) {
+    close();
+    path = filePath;
+    if (!file.open(path, MappedFile::Access::Random))
+        return false;
+    if (!readChunkTable(file, path, chunks, bounds)) {
+        chunks.clear();
+        file.close();
+        return false;
+    }
+
+    // Split the budget between the shared buffers in the file's own vertex/index proportion
+    uint64_t vertexBytes = 0, totalBytes = 0, largest = 0;
+    for (const ChunkRecord& chunk : chunks) {
+        vertexBytes += chunk.vertexCount * uint64_t(sizeof(Vertex));
+        totalBytes += chunk.getSize();
+        largest = std::max(largest, chunk.getSize());
+    }
+    // The arena never outgrows the budget, or the whole file with its headroom; the headroom
+    // comes out of what may be resident instead
+    double arenaBytes = std::min(static_cast<double>(budgetBytes), totalBytes * kArenaHeadroom);
+    if (arenaBytes / kArenaHeadroom < largest) {
+        std::cerr << path << ": a " << budgetBytes / 1024 << " KB budget cannot hold the largest chunk ("
+                  << largest / 1024 << " KB) with room for fragmentation\n";
+        chunks.clear();
+        file.close();
+        return false;
+    }
+    budget = static_cast<size_t>(arenaBytes / kArenaHeadroom);
+    effectiveBudget = budget;
+    largestChunk = largest;
+    lastBudgetChange = 0;
+    double vertexShare = static_cast<double>(vertexBytes) / static_cast<double>(totalBytes);
+    size_t maxElements = std::numeric_limits<uint32_t>::max();
+    size_t vertexCapacity = std::min(maxElements, static_cast<size_t>(arenaBytes * vertexShare / sizeof(Vertex)));
+    size_t indexCapacity = std::min(maxElements, static_cast<size_t>(arenaBytes * (1.0 - vertexShare) / sizeof(GLuint)));
+    if (!arena.init(vertexCapacity, indexCapacity, 1) || !drawList.init()) {
+        std::cerr << path << ": could not allocate " << static_cast<size_t>(arenaBytes) / (1024 * 1024) << " MB of GPU storage\n";
+        close();
+        return false;
+    }
+    arena.setInstances({ Instance() });
+
+    // A chunk whose vertex/index mix is far from the file's may not fit its share of the empty
+    // arena; it would be loaded again every frame, so never request it
+    states.assign(chunks.size(), ChunkState());
+    size_t unfit = 0;
+    for (uint32_t c = 0; c < chunks.size(); ++c) {
+        if (!arena.fits(chunks[c].vertexCount, chunks[c].indexCount)) {
+            states[c].broken = true;
+            ++unfit;
+        }
+    }
+    if (unfit > 0)
+        std::cerr << path << ": " << unfit << " chunk(s) do not fit the arena's vertex/index split, skipping them\n";
+    culling.clear();
+    culling.reserve(chunks.size());
+    for (const ChunkRecord& chunk : chunks)
+        culling.addBox(chunk.bounds);
+    stats = StreamingStats();
+    frame = 0;
+    hasPreviousEye = false;
+    eyeVelocity = glm::dvec3(0.0);
+
+    stopping = false;
+    loader = std::thread(&ChunkStreamer::loadLoop, this);
+    return true;
+}
+
+void ChunkStreamer::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (loader.joinable())
+        loader.join();
+    requests.clear();
+    staged.clear();
+
+    // Only touch GL when open() got that far, the destructor may run without a context
+    if (!chunks.empty()) {
+        arena.cleanup();
+        drawList.cleanup();
+    }
+    chunks.clear();
+    states.clear();
+    visibility.clear();
+    file.close();
+    residentBytes = 0;
+    budget = 0;
+    effectiveBudget = 0;
+    largestChunk = 0;
+}
+
+void ChunkStreamer::update(const Camera& camera, const glm::dmat4& model) {
+    if (chunks.empty())
+        return;
+    ++frame;
+
+    // Evictions since the budget last changed have come back through the fences and may have
+    // left room for more; try a chunk's worth again, a shrink takes it back if not
+    if (effectiveBudget < budget && lastEviction > lastBudgetChange && frame - lastEviction >= kFramesInFlight) {
+        effectiveBudget = std::min(budget, effectiveBudget + largestChunk);
+        lastBudgetChange = frame;
+    }
+
+    // Prefetch ranks every chunk from where the eye will be as well as from where it is
+    glm::dvec3 eye = camera.getEyePosition();
+    if (hasPreviousEye)
+        eyeVelocity += (eye - previousEye - eyeVelocity) * kVelocitySmoothing;
+    previousEye = eye;
+    hasPreviousEye = true;
+    glm::dvec3 predictedEye = eye + eyeVelocity * kPrefetchFrames;
+
+    glm::mat4 relativeModel = camera.getRelativeModelMatrix(model);
+    for (uint32_t c = 0; c < chunks.size(); ++c)
+        culling.setBox(c, transformBounds(chunks[c].bounds, relativeModel));
+    culling.cull(camera.getFrustum(), visibility);
+
+    double scale = std::max({ glm::length(glm::dvec3(model[0])), glm::length(glm::dvec3(model[1])), glm::length(glm::dvec3(model[2])) });
+    auto projectedPixels = [&camera](const glm::dvec3& from, const glm::dvec3& center, double radius) {
+        double distance = std::max(glm::length(center - from) - radius, 0.01 * radius);
+        return 2.0 * radius * camera.getPixelsPerUnit(distance);
+    };
+
+    ranking.clear();
+    for (uint32_t c = 0; c < chunks.size(); ++c) {
+        ChunkState& state = states[c];
+        if (state.broken)
+            continue;
+        glm::dvec3 center = glm::dvec3(model * glm::dvec4(glm::dvec3(chunks[c].bounds.center()), 1.0));
+        double radius = glm::length(glm::dvec3(chunks[c].bounds.extent())) * scale;
+        double pixels = std::max(projectedPixels(eye, center, radius), projectedPixels(predictedEye, center, radius));
+        if (!CullingSet::isVisible(visibility, c))
+            pixels *= kOffscreenWeight;
+        state.priority = static_cast<float>(pixels);
+        if (pixels >= kMinPixels)
+            ranking.push_back(c);
+    }
+    std::sort(ranking.begin(), ranking.end(), [this](uint32_t a, uint32_t b) { return states[a].priority > states[b].priority; });
+
+    // The wanted set: the best chunks that fit the budget together
+    size_t wantedBytes = 0;
+    stats.wantedChunks = 0;
+    for (uint32_t c : ranking) {
+        size_t size = chunks[c].getSize();
+        if (wantedBytes + size > effectiveBudget)
+            continue;
+        wantedBytes += size;
+        states[c].lastWanted = frame;
+        ++stats.wantedChunks;
+    }
+
+    // Replace the unclaimed requests with this frame's, best last; chunks the loader has already
+    // taken stay requested until they are uploaded
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (uint32_t c : requests)
+            states[c].requested = false;
+        requests.clear();
+        for (auto it = ranking.rbegin(); it != ranking.rend(); ++it) {
+            ChunkState& state = states[*it];
+            if (state.lastWanted == frame && !state.resident && !state.requested) {
+                state.requested = true;
+                requests.push_back(*it);
+            }
+        }
+    }
+    wake.notify_one();
+
+    for (size_t i = 0; i < kMaxUploadsPerFrame; ++i) {
+        StagedChunk chunk;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (staged.empty())
+                break;
+            chunk = std::move(staged.front());
+            staged.pop_front();
+        }
+        wake.notify_one();
+        if (!upload(chunk)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            staged.push_front(std::move(chunk));
+            break;
+        }
+    }
+
+    stats.residentChunks = 0;
+    stats.pendingLoads = 0;
+    for (const ChunkState& state : states) {
+        stats.residentChunks += state.resident ? 1 : 0;
+        stats.pendingLoads += state.requested ? 1 : 0;
+    }
+    stats.residentBytes = residentBytes;
+}
+
+bool ChunkStreamer::upload(StagedChunk& chunk) {
+    ChunkState& state = states[chunk.chunk];
+    if (chunk.indices.empty()) {
+        state.requested = false;
+        state.broken = true;
+        return true;
+    }
+    // Ranked out while it was loading
+    if (state.resident || state.lastWanted != frame) {
+        state.requested = false;
+        return true;
+    }
+
+    size_t size = chunks[chunk.chunk].getSize();
+    while (residentBytes + size > effectiveBudget) {
+        if (!evictLeastRecent())
+            break;
+    }
+    if (residentBytes + size > effectiveBudget || !arena.fits(chunk.vertices.size(), chunk.indices.size())) {
+        // Evicted ranges come back through the arena's fences a few frames later, so give up
+        // one more range at a time and try again once it is back
+        if (frame - lastEviction < kFramesInFlight || evictLeastRecent())
+            return false;
+        // Every resident chunk is wanted and the arena is still too splintered for this one:
+        // want less from now on, instead of loading it again every frame
+        effectiveBudget -= std::min(effectiveBudget - std::min(effectiveBudget, size), size);
+        lastBudgetChange = frame;
+        state.requested = false;
+        return true;
+    }
+
+    if (!arena.add(chunk.vertices, chunk.indices, state.range))
+        return false;
+    state.requested = false;
+    state.range.bounds = chunks[chunk.chunk].bounds;
+    state.resident = true;
+    residentBytes += size;
+    ++stats.loads;
+    return true;
+}
+
+bool ChunkStreamer::evictLeastRecent() {
+    uint32_t victim = std::numeric_limits<uint32_t>::max();
+    for (uint32_t c = 0; c < states.size(); ++c) {
+        const ChunkState& state = states[c];
+        if (state.resident && state.lastWanted != frame
+            && (victim == std::numeric_limits<uint32_t>::max() || state.lastWanted < states[victim].lastWanted))
+            victim = c;
+    }
+    if (victim == std::numeric_limits<uint32_t>::max())
+        return false;
+
+    ChunkState& state = states[victim];
+    arena.remove(state.range);
+    state.resident = false;
+    residentBytes -= chunks[victim].getSize();
+    lastEviction = frame;
+    ++stats.evictions;
+    return true;
+}
+
+size_t ChunkStreamer::draw() {
+    drawList.clear();
+    stats.drawnChunks = 0;
+    if (visibility.empty())
+        return 0;
+    for (uint32_t c = 0; c < states.size(); ++c) {
+        if (states[c].resident && CullingSet::isVisible(visibility, c)) {
+            drawList.add(states[c].range, 0);
+            ++stats.drawnChunks;
+        }
+    }
+    return drawList.submit(arena);
+}
+
+void ChunkStreamer::loadLoop() {
+    while (true) {
+        uint32_t chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || (!requests.empty() && staged.size() < kMaxStagedChunks); });
+            if (stopping)
+                return;
+            chunk = requests.back();
+            requests.pop_back();
+        }
+
+        // Copy out of the mapping, then hand the pages back so only the staging copy is resident
+        const ChunkRecord& record = chunks[chunk];
+        const char* data = file.data() + record.offset;
+        StagedChunk result;
+        result.chunk = chunk;
+        result.vertices.resize(record.vertexCount);
+        result.indices.resize(record.indexCount);
+        std::memcpy(result.vertices.data(), data, record.vertexCount * sizeof(Vertex));
+        std::memcpy(result.indices.data(), data + record.vertexCount * sizeof(Vertex), record.indexCount * sizeof(GLuint));
+        file.release(record.offset, (record.getSize() + kChunkAlignment - 1) & ~(kChunkAlignment - 1));
+
+        if (*std::max_element(result.indices.begin(), result.indices.end()) >= record.vertexCount) {
+            std::cerr << path << ": chunk " << chunk << " indexes past its vertices, skipping it\n";
+            result.vertices.clear();
+            result.indices.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        staged.push_back(std::move(result));
+    }
+}
@@ -0,0 +1,133 @@
+//
+//  chunk_streamer.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/26/25.
+//
+
+#ifndef chunk_streamer_hpp
+#define chunk_streamer_hpp
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera.hpp"
+#include "culling.hpp"
+#include "geometry_arena.hpp"
+#include "mesh_chunks.hpp"
+
+struct StreamingStats {
+    size_t residentChunks = 0;
+    size_t residentBytes = 0;
+    size_t wantedChunks = 0;    // chosen for residency this frame
+    size_t pendingLoads = 0;    // requested and not uploaded yet
+    size_t drawnChunks = 0;
+    size_t loads = 0;           // totals since open
+    size_t evictions = 0;
+};
+
+// Out-of-core viewer for chunk files (see writeChunkFile). Every frame the render thread ranks
+// the chunks by projected size from the camera eye and from where the eye is heading, keeps the
+// best of them resident within a byte budget and asks a loader thread for the missing ones.
+// Loaded chunks are uploaded a few per frame into a GeometryArena within the budget, evicting
+// the least recently wanted chunks to make room, and resident chunks inside the frustum are
+// drawn through one DrawList. Only the file's chunk table stays in host memory.
+class ChunkStreamer {
+public:
+    static constexpr size_t kMaxUploadsPerFrame = 4;
+    // Loaded chunks waiting for upload; bounds the host memory of the staging copies
+    static constexpr size_t kMaxStagedChunks = 8;
+    // Prefetch looks this many frames ahead along the smoothed eye velocity
+    static constexpr double kPrefetchFrames = 30.0;
+    // Chunks smaller than this on screen are not worth memory
+    static constexpr double kMinPixels = 2.0;
+
+    ChunkStreamer() = default;
+    ~ChunkStreamer() { close(); }
+    ChunkStreamer(const ChunkStreamer&) = delete;
+    ChunkStreamer& operator=(const ChunkStreamer&) = delete;
+
+    // Maps the file, reads the chunk table and allocates at most budgetBytes of GPU storage
+    bool open(const std::string& path, size_t budgetBytes);
+    // Stops the loader and frees the GPU storage; needs the context current
+    void close();
+
+    // Render thread, once per frame before draw()
+    void update(const Camera& camera, const glm::dmat4& model);
+    // Draws the resident chunks in the frustum with the bound program and ObjectBlock; returns
+    // the number of GL draw calls
+    size_t draw();
+    // After the frame's last draw: lets the arena recycle evicted ranges
+    void endFrame() { arena.endFrame(); }
+
+    const BoundingBox& getBounds() const { return bounds; }
+    size_t getChunkCount() const { return chunks.size(); }
+    // Resident bytes allowed, the arena's size less its headroom
+    size_t getBudget() const { return budget; }
+    const StreamingStats& getStats() const { return stats; }
+
+private:
+    struct ChunkState {
+        ArenaMesh range;
+        uint64_t lastWanted = 0;   // frame number, the LRU key
+        float priority = 0.0f;     // projected pixels, this frame
+        bool resident = false;
+        bool requested = false;    // queued, loading or staged
+        bool broken = false;       // failed validation, never requested again
+    };
+
+    struct StagedChunk {
+        uint32_t chunk = 0;
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;   // empty when the chunk failed validation
+    };
+
+    void loadLoop();
+    bool evictLeastRecent();
+    // False when the arena cannot take the chunk until recent evictions come back
+    bool upload(StagedChunk& staged);
+
+    std::string path;
+    MappedFile file;
+    std::vector<ChunkRecord> chunks;
+    std::vector<ChunkState> states;
+    BoundingBox bounds;
+    size_t budget = 0;
+    size_t effectiveBudget = 0;   // the budget less what arena fragmentation has cost
+    size_t largestChunk = 0;      // bytes, the step effectiveBudget recovers by
+    size_t residentBytes = 0;
+
+    GeometryArena arena;
+    DrawList drawList;
+    CullingSet culling;
+    std::vector<uint64_t> visibility;
+    std::vector<uint32_t> ranking;
+
+    uint64_t frame = 0;
+    uint64_t lastEviction = 0;
+    uint64_t lastBudgetChange = 0;
+    glm::dvec3 previousEye = glm::dvec3(0.0);
+    glm::dvec3 eyeVelocity = glm::dvec3(0.0);   // world units per frame, smoothed
+    bool hasPreviousEye = false;
+    StreamingStats stats;
+
+    // Shared with the loader thread
+    std::thread loader;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<uint32_t> requests;   // lowest priority first, the loader takes from the back
+    std::deque<StagedChunk> staged;
+    bool stopping = false;
+};
+
+#endif /* chunk_streamer_hpp */
@@ -0,0 +1,212 @@
+//
+//  culling.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 6/2/25.
+//
+
+#include "culling.hpp"
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULLING_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CULLING_SSE 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define CULLING_NEON 1
+#endif
+
+Frustum extractFrustum(const glm::mat4& m, ClipDepth depth) {
+    // Gribb/Hartmann: combine the rows of the clip matrix (glm is column-major)
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[Frustum::Left]   = row3 + row0;
+    frustum.planes[Frustum::Right]  = row3 - row0;
+    frustum.planes[Frustum::Bottom] = row3 + row1;
+    frustum.planes[Frustum::Top]    = row3 - row1;
+    if (depth == ClipDepth::ReversedZeroToOne) {
+        frustum.planes[Frustum::Near] = row3 - row2;
+        frustum.planes[Frustum::Far]  = row2;
+    } else {
+        frustum.planes[Frustum::Near] = row3 + row2;
+        frustum.planes[Frustum::Far]  = row3 - row2;
+    }
+
+    // An infinite far plane degenerates to a zero normal, keep it as an always-passing plane
+    for (glm::vec4& plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane));
+        plane = (length > 0.0f) ? plane / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    return frustum;
+}
+
+Frustum offsetFrustum(const Frustum& frustum, const glm::vec3& offset) {
+    Frustum result = frustum;
+    for (glm::vec4& plane : result.planes)
+        plane.w += glm::dot(glm::vec3(plane), offset);
+    return result;
+}
+
+void CullingSet::clear() {
+    centerX.clear(); centerY.clear(); centerZ.clear();
+    extentX.clear(); extentY.clear(); extentZ.clear();
+    radius.clear();
+}
+
+void CullingSet::reserve(size_t count) {
+    centerX.reserve(count); centerY.reserve(count); centerZ.reserve(count);
+    extentX.reserve(count); extentY.reserve(count); extentZ.reserve(count);
+    radius.reserve(count);
+}
+
+uint32_t CullingSet::addBox(const BoundingBox& box) {
+    uint32_t index = static_cast<uint32_t>(size());
+    centerX.push_back(0); centerY.push_back(0); centerZ.push_back(0);
+    extentX.push_back(0); extentY.push_back(0); extentZ.push_back(0);
+    radius.push_back(0);
+    setBox(index, box);
+    return index;
+}
+
+uint32_t CullingSet::addSphere(const glm::vec3& center, float r) {
+    uint32_t index = static_cast<uint32_t>(size());
+    centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+    extentX.push_back(0); extentY.push_back(0); extentZ.push_back(0);
+    radius.push_back(r);
+    return index;
+}
+
+void CullingSet::setBox(uint32_t index, const BoundingBox& box) {
+    glm::vec3 center = box.center();
+    glm::vec3 extent = box.extent();
+    centerX[index] = center.x; centerY[index] = center.y; centerZ[index] = center.z;
+    extentX[index] = extent.x; extentY[index] = extent.y; extentZ[index] = extent.z;
+    radius[index] = 0.0f;
+}
+
+size_t CullingSet::cull(const Frustum& frustum, std::vector<uint64_t>& visibility, CullStats* stats) const {
+    const size_t count = size();
+    visibility.assign((count + 63) / 64, 0);
+
+    // An entry survives a plane when its center distance plus the box's projected
+    // half-size (and sphere radius) is non-negative, and it is visible when it survives all six
+    size_t i = 0;
+
+#if CULLING_AVX
+    __m256 nx[Frustum::Count], ny[Frustum::Count], nz[Frustum::Count], nw[Frustum::Count];
+    __m256 ax[Frustum::Count], ay[Frustum::Count], az[Frustum::Count];
+    for (int p = 0; p < Frustum::Count; ++p) {
+        const glm::vec4& plane = frustum.planes[p];
+        nx[p] = _mm256_set1_ps(plane.x); ny[p] = _mm256_set1_ps(plane.y);
+        nz[p] = _mm256_set1_ps(plane.z); nw[p] = _mm256_set1_ps(plane.w);
+        ax[p] = _mm256_set1_ps(std::fabs(plane.x)); ay[p] = _mm256_set1_ps(std::fabs(plane.y));
+        az[p] = _mm256_set1_ps(std::fabs(plane.z));
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        __m256 cx = _mm256_loadu_ps(&centerX[i]), cy = _mm256_loadu_ps(&centerY[i]), cz = _mm256_loadu_ps(&centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&extentX[i]), ey = _mm256_loadu_ps(&extentY[i]), ez = _mm256_loadu_ps(&extentZ[i]);
+        __m256 r = _mm256_loadu_ps(&radius[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < Frustum::Count; ++p) {
+            __m256 d = _mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy));
+            d = _mm256_add_ps(d, _mm256_mul_ps(nz[p], cz));
+            d = _mm256_add_ps(d, _mm256_add_ps(nw[p], r));
+            d = _mm256_add_ps(d, _mm256_mul_ps(ax[p], ex));
+            d = _mm256_add_ps(d, _mm256_mul_ps(ay[p], ey));
+            d = _mm256_add_ps(d, _mm256_mul_ps(az[p], ez));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, zero, _CMP_GE_OQ));
+        }
+        uint64_t bits = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+        visibility[i >> 6] |= bits << (i & 63);
+    }
+#elif CULLING_SSE
+    __m128 nx[Frustum::Count], ny[Frustum::Count], nz[Frustum::Count], nw[Frustum::Count];
+    __m128 ax[Frustum::Count], ay[Frustum::Count], az[Frustum::Count];
+    for (int p = 0; p < Frustum::Count; ++p) {
+        const glm::vec4& plane = frustum.planes[p];
+        nx[p] = _mm_set1_ps(plane.x); ny[p] = _mm_set1_ps(plane.y);
+        nz[p] = _mm_set1_ps(plane.z); nw[p] = _mm_set1_ps(plane.w);
+        ax[p] = _mm_set1_ps(std::fabs(plane.x)); ay[p] = _mm_set1_ps(std::fabs(plane.y));
+        az[p] = _mm_set1_ps(std::fabs(plane.z));
+    }
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        __m128 cx = _mm_loadu_ps(&centerX[i]), cy = _mm_loadu_ps(&centerY[i]), cz = _mm_loadu_ps(&centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&extentX[i]), ey = _mm_loadu_ps(&extentY[i]), ez = _mm_loadu_ps(&extentZ[i]);
+        __m128 r = _mm_loadu_ps(&radius[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < Frustum::Count; ++p) {
+            __m128 d = _mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy));
+            d = _mm_add_ps(d, _mm_mul_ps(nz[p], cz));
+            d = _mm_add_ps(d, _mm_add_ps(nw[p], r));
+            d = _mm_add_ps(d, _mm_mul_ps(ax[p], ex));
+            d = _mm_add_ps(d, _mm_mul_ps(ay[p], ey));
+            d = _mm_add_ps(d, _mm_mul_ps(az[p], ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, zero));
+        }
+        uint64_t bits = static_cast<uint32_t>(_mm_movemask_ps(inside));
+        visibility[i >> 6] |= bits << (i & 63);
+    }
+#elif CULLING_NEON
+    float32x4_t nx[Frustum::Count], ny[Frustum::Count], nz[Frustum::Count], nw[Frustum::Count];
+    float32x4_t ax[Frustum::Count], ay[Frustum::Count], az[Frustum::Count];
+    for (int p = 0; p < Frustum::Count; ++p) {
+        const glm::vec4& plane = frustum.planes[p];
+        nx[p] = vdupq_n_f32(plane.x); ny[p] = vdupq_n_f32(plane.y);
+        nz[p] = vdupq_n_f32(plane.z); nw[p] = vdupq_n_f32(plane.w);
+        ax[p] = vdupq_n_f32(std::fabs(plane.x)); ay[p] = vdupq_n_f32(std::fabs(plane.y));
+        az[p] = vdupq_n_f32(std::fabs(plane.z));
+    }
+    const uint32_t laneBitsData[4] = { 1, 2, 4, 8 };
+    const uint32x4_t laneBits = vld1q_u32(laneBitsData);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t cx = vld1q_f32(&centerX[i]), cy = vld1q_f32(&centerY[i]), cz = vld1q_f32(&centerZ[i]);
+        float32x4_t ex = vld1q_f32(&extentX[i]), ey = vld1q_f32(&extentY[i]), ez = vld1q_f32(&extentZ[i]);
+        float32x4_t r = vld1q_f32(&radius[i]);
+        uint32x4_t inside = vdupq_n_u32(0xFFFFFFFFu);
+        for (int p = 0; p < Frustum::Count; ++p) {
+            float32x4_t d = vaddq_f32(nw[p], r);
+            d = vfmaq_f32(d, nx[p], cx);
+            d = vfmaq_f32(d, ny[p], cy);
+            d = vfmaq_f32(d, nz[p], cz);
+            d = vfmaq_f32(d, ax[p], ex);
+            d = vfmaq_f32(d, ay[p], ey);
+            d = vfmaq_f32(d, az[p], ez);
+            inside = vandq_u32(inside, vcgeq_f32(d, zero));
+        }
+        uint64_t bits = vaddvq_u32(vandq_u32(inside, laneBits));
+        visibility[i >> 6] |= bits << (i & 63);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        bool inside = true;
+        for (int p = 0; p < Frustum::Count && inside; ++p) {
+            const glm::vec4& plane = frustum.planes[p];
+            float d = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w + radius[i]
+                    + std::fabs(plane.x) * extentX[i] + std::fabs(plane.y) * extentY[i] + std::fabs(plane.z) * extentZ[i];
+            inside = d >= 0.0f;
+        }
+        if (inside)
+            visibility[i >> 6] |= uint64_t(1) << (i & 63);
+    }
+
+    size_t visible = 0;
+    for (uint64_t word : visibility)
+        visible += static_cast<size_t>(__builtin_popcountll(word));
+
+    if (stats) {
+        stats->tested += count;
+        stats->visible += visible;
+    }
+    return visible;
+}
@@ -0,0 +1,71 @@
+//
+//  culling.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 6/2/25.
+//
+
+#ifndef culling_hpp
+#define culling_hpp
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bounds.hpp"
+
+// Six normalized planes (xyz = inward normal, w = distance), a point is inside when dot(n, p) + w >= 0
+struct Frustum {
+    enum Plane { Left, Right, Bottom, Top, Near, Far, Count };
+    glm::vec4 planes[Count];
+};
+
+// Clip-space depth convention the view-projection was built for
+enum class ClipDepth {
+    NegativeOneToOne,   // OpenGL default, near at -w and far at +w
+    ReversedZeroToOne   // glClipControl(GL_ZERO_TO_ONE) with near at depth 1 and far at 0
+};
+
+Frustum extractFrustum(const glm::mat4& viewProjection, ClipDepth depth = ClipDepth::NegativeOneToOne);
+
+// Re-expresses a frustum for points given relative to another origin (p' = p + offset)
+Frustum offsetFrustum(const Frustum& frustum, const glm::vec3& offset);
+
+struct CullStats {
+    size_t tested = 0;
+    size_t visible = 0;
+
+    size_t culled() const { return tested - visible; }
+};
+
+// Bounds kept as structure-of-arrays so the culler can test several objects per SIMD lane group
+class CullingSet {
+public:
+    void clear();
+    void reserve(size_t count);
+
+    // Returns the index of the entry, which is also its bit in the visibility mask
+    uint32_t addBox(const BoundingBox& box);
+    uint32_t addSphere(const glm::vec3& center, float radius);
+    void setBox(uint32_t index, const BoundingBox& box);
+
+    size_t size() const { return centerX.size(); }
+
+    // Writes one bit per entry (bit i of word i / 64) and returns the visible count
+    size_t cull(const Frustum& frustum, std::vector<uint64_t>& visibility, CullStats* stats = nullptr) const;
+
+    static bool isVisible(const std::vector<uint64_t>& visibility, uint32_t index) {
+        return (visibility[index >> 6] >> (index & 63)) & 1;
+    }
+
+private:
+    // Spheres are stored with a zero extent, boxes with a zero radius
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::vector<float> radius;
+};
+
+#endif /* culling_hpp */
@@ -0,0 +1,267 @@
+//
+//  geometry_arena.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/14/25.
+//
+
+#include "geometry_arena.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+namespace {
+
+void setInstanceAttributes(GLintptr firstInstanceOffset) {
+    for (GLuint column = 0; column < 4; ++column) {
+        GLuint location = Mesh::kInstanceModelLocation + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                              (void*)(firstInstanceOffset + offsetof(Instance, model) + column * sizeof(glm::vec4)));
+    }
+    glVertexAttribPointer(Mesh::kInstanceColorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                          (void*)(firstInstanceOffset + offsetof(Instance, color)));
+}
+
+}
+
+bool GeometryArena::init(size_t vertexCapacity, size_t indexCapacity, size_t instances) {
+    vertexAllocator.reset(static_cast<uint32_t>(vertexCapacity));
+    indexAllocator.reset(static_cast<uint32_t>(indexCapacity));
+    instanceCapacity = instances;
+    instanceCount = 0;
+
+    // Errors left over from earlier calls would read as a failed allocation
+    while (glGetError() != GL_NO_ERROR) {}
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glGenBuffers(1, &instanceVBO);
+
+    glBindVertexArray(VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexCapacity * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+    glEnableVertexAttribArray(1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(Instance), nullptr, GL_DYNAMIC_DRAW);
+    setInstanceAttributes(0);
+    for (GLuint location = Mesh::kInstanceModelLocation; location <= Mesh::kInstanceColorLocation; ++location) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return glGetError() == GL_NO_ERROR;
+}
+
+void GeometryArena::cleanup() {
+    // Everything goes away with the buffers, no need to wait for pending frees
+    for (PendingFrees& frees : fencedFrees)
+        glDeleteSync(frees.fence);
+    fencedFrees.clear();
+    currentFrees = PendingFrees();
+
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteBuffers(1, &instanceVBO);
+    VAO = VBO = EBO = instanceVBO = 0;
+    vertexAllocator.reset(0);
+    indexAllocator.reset(0);
+    instanceCount = 0;
+}
+
+bool GeometryArena::add(const Mesh& mesh, ArenaMesh& range) {
+    if (!add(mesh.getVertices(), mesh.getIndices(), range))
+        return false;
+    range.bounds = mesh.getBounds();
+    return true;
+}
+
+bool GeometryArena::add(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, ArenaMesh& range) {
+    OffsetAllocator::Allocation vertexRange = vertexAllocator.allocate(static_cast<uint32_t>(vertices.size()));
+    OffsetAllocator::Allocation indexRange = indexAllocator.allocate(static_cast<uint32_t>(indices.size()));
+    if (!vertexRange.isValid() || !indexRange.isValid()) {
+        vertexAllocator.free(vertexRange);
+        indexAllocator.free(indexRange);
+        std::cerr << "Geometry arena has no room for " << vertices.size() << " vertices and "
+                  << indices.size() << " indices\n";
+        return false;
+    }
+
+    // Indices stay mesh-local, baseVertex rebases them at draw time
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, vertexRange.offset * sizeof(Vertex), vertices.size() * sizeof(Vertex), vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindVertexArray(VAO);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexRange.offset * sizeof(GLuint), indices.size() * sizeof(GLuint), indices.data());
+    glBindVertexArray(0);
+
+    range.baseVertex = static_cast<GLint>(vertexRange.offset);
+    range.firstIndex = indexRange.offset;
+    range.indexCount = static_cast<GLsizei>(indices.size());
+    range.vertexCount = static_cast<GLsizei>(vertices.size());
+    range.vertexAllocation = vertexRange;
+    range.indexAllocation = indexRange;
+    range.bounds = BoundingBox();
+    for (const Vertex& vertex : vertices)
+        expandBounds(range.bounds, vertex.position);
+    return true;
+}
+
+void GeometryArena::remove(ArenaMesh& range) {
+    if (!range.isValid())
+        return;
+
+    currentFrees.vertices.push_back(range.vertexAllocation);
+    currentFrees.indices.push_back(range.indexAllocation);
+    range = ArenaMesh();
+}
+
+void GeometryArena::endFrame() {
+    if (!currentFrees.vertices.empty()) {
+        currentFrees.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        fencedFrees.push_back(std::move(currentFrees));
+        currentFrees = PendingFrees();
+    }
+
+    // Fences signal in submission order, stop at the first one still pending
+    size_t released = 0;
+    for (PendingFrees& frees : fencedFrees) {
+        GLenum status = glClientWaitSync(frees.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+
+        glDeleteSync(frees.fence);
+        for (OffsetAllocator::Allocation allocation : frees.vertices)
+            vertexAllocator.free(allocation);
+        for (OffsetAllocator::Allocation allocation : frees.indices)
+            indexAllocator.free(allocation);
+        ++released;
+    }
+    fencedFrees.erase(fencedFrees.begin(), fencedFrees.begin() + static_cast<std::ptrdiff_t>(released));
+}
+
+bool GeometryArena::setInstances(const std::vector<Instance>& instances) {
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (instances.size() > instanceCapacity) {
+        instanceCapacity = instances.size();
+        glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(Instance), instances.data(), GL_DYNAMIC_DRAW);
+    } else {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(Instance), instances.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    instanceCount = instances.size();
+    return true;
+}
+
+bool DrawList::init() {
+    // baseInstance in the indirect command is ignored without ARB_base_instance
+    indirect = (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect) && (GLEW_VERSION_4_2 || GLEW_ARB_base_instance);
+    if (indirect)
+        glGenBuffers(1, &indirectBuffer);
+    return true;
+}
+
+void DrawList::cleanup() {
+    glDeleteBuffers(1, &indirectBuffer);
+    indirectBuffer = 0;
+    indirectCapacity = 0;
+    commands.clear();
+}
+
+void DrawList::add(const ArenaMesh& mesh, GLuint firstInstance, GLuint instanceCount) {
+    // Same range with the next instances: grow the previous draw instead of adding one
+    if (!commands.empty()) {
+        DrawElementsIndirectCommand& last = commands.back();
+        if (last.firstIndex == mesh.firstIndex && last.count == static_cast<GLuint>(mesh.indexCount)
+            && last.baseVertex == mesh.baseVertex && last.baseInstance + last.instanceCount == firstInstance) {
+            last.instanceCount += instanceCount;
+            return;
+        }
+    }
+    commands.push_back({ static_cast<GLuint>(mesh.indexCount), instanceCount, mesh.firstIndex, mesh.baseVertex, firstInstance });
+}
+
+size_t DrawList::submit(const GeometryArena& arena) const {
+    if (commands.empty())
+        return 0;
+
+    glBindVertexArray(arena.getVAO());
+    size_t calls = indirect ? submitIndirect() : submitBaseVertex(arena);
+    glBindVertexArray(0);
+    return calls;
+}
+
+size_t DrawList::submitIndirect() const {
+    size_t bytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    if (bytes > indirectCapacity) {
+        indirectCapacity = bytes;
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity, commands.data(), GL_STREAM_DRAW);
+    } else {
+        // Orphan, the previous frame's commands may still be read by the GPU
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, bytes, commands.data());
+    }
+
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(commands.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    return 1;
+}
+
+size_t DrawList::submitBaseVertex(const GeometryArena& arena) const {
+    // Without baseInstance the instance attributes are re-pointed per run of draws
+    // that share the same instance range
+    size_t calls = 0;
+    glBindBuffer(GL_ARRAY_BUFFER, arena.getInstanceBuffer());
+
+    size_t begin = 0;
+    while (begin < commands.size()) {
+        const DrawElementsIndirectCommand& first = commands[begin];
+        size_t end = begin + 1;
+        while (end < commands.size() && commands[end].baseInstance == first.baseInstance
+               && commands[end].instanceCount == first.instanceCount)
+            ++end;
+
+        setInstanceAttributes(static_cast<GLintptr>(first.baseInstance) * sizeof(Instance));
+
+        if (first.instanceCount == 1) {
+            counts.clear();
+            offsets.clear();
+            baseVertices.clear();
+            for (size_t i = begin; i < end; ++i) {
+                counts.push_back(static_cast<GLsizei>(commands[i].count));
+                offsets.push_back((const void*)(uintptr_t(commands[i].firstIndex) * sizeof(GLuint)));
+                baseVertices.push_back(commands[i].baseVertex);
+            }
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(),
+                                          static_cast<GLsizei>(counts.size()), baseVertices.data());
+            ++calls;
+        } else {
+            for (size_t i = begin; i < end; ++i) {
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(commands[i].count), GL_UNSIGNED_INT,
+                                                  (const void*)(uintptr_t(commands[i].firstIndex) * sizeof(GLuint)),
+                                                  static_cast<GLsizei>(commands[i].instanceCount), commands[i].baseVertex);
+                ++calls;
+            }
+        }
+        begin = end;
+    }
+
+    setInstanceAttributes(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return calls;
+}
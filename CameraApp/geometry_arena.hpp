@@ -0,0 +1,117 @@
+//
+//  geometry_arena.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/14/25.
+//
+
+#ifndef geometry_arena_hpp
+#define geometry_arena_hpp
+
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+#include "mesh.hpp"
+#include "offset_allocator.hpp"
+
+// Where a mesh lives inside the arena's shared buffers
+struct ArenaMesh {
+    GLint baseVertex = 0;
+    GLuint firstIndex = 0;
+    GLsizei indexCount = 0;
+    GLsizei vertexCount = 0;
+    BoundingBox bounds;
+
+    OffsetAllocator::Allocation vertexAllocation, indexAllocation;
+    bool isValid() const { return vertexAllocation.isValid(); }
+};
+
+// Layout fixed by GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// One vertex buffer, one index buffer and one instance buffer shared by many meshes, behind a
+// single VAO with the Mesh attribute layout, so the same shaders draw from either.
+class GeometryArena {
+public:
+    bool init(size_t vertexCapacity, size_t indexCapacity, size_t instanceCapacity);
+    void cleanup();
+
+    // Copies the geometry into suballocated ranges; false when no range is large enough
+    bool add(const Mesh& mesh, ArenaMesh& range);
+    bool add(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, ArenaMesh& range);
+    // Whether add() would find ranges for this much geometry right now
+    bool fits(size_t vertexCount, size_t indexCount) const {
+        return vertexAllocator.canAllocate(static_cast<uint32_t>(vertexCount)) && indexAllocator.canAllocate(static_cast<uint32_t>(indexCount));
+    }
+    // The ranges are reused only once the GPU has finished the frame that last drew them
+    void remove(ArenaMesh& range);
+    // Call once per frame after the last draw: fences this frame's removals and
+    // releases earlier ones whose fence has signaled, without waiting
+    void endFrame();
+
+    const OffsetAllocator& getVertexAllocator() const { return vertexAllocator; }
+    const OffsetAllocator& getIndexAllocator() const { return indexAllocator; }
+
+    // Replaces the instance table, draws pick their instances from it by index
+    bool setInstances(const std::vector<Instance>& instances);
+    size_t getInstanceCount() const { return instanceCount; }
+
+    GLuint getVAO() const { return VAO; }
+    GLuint getInstanceBuffer() const { return instanceVBO; }
+
+private:
+    struct PendingFrees {
+        GLsync fence = nullptr;
+        std::vector<OffsetAllocator::Allocation> vertices, indices;
+    };
+
+    GLuint VAO = 0, VBO = 0, EBO = 0, instanceVBO = 0;
+    OffsetAllocator vertexAllocator, indexAllocator;
+    size_t instanceCapacity = 0, instanceCount = 0;
+
+    PendingFrees currentFrees;              // removed this frame, not fenced yet
+    std::vector<PendingFrees> fencedFrees;  // oldest first
+};
+
+// Collects draws against one arena and submits them in as few calls as the context allows:
+// a single glMultiDrawElementsIndirect on 4.3, one glMultiDrawElementsBaseVertex per run of
+// draws sharing an instance on 3.3.
+class DrawList {
+public:
+    bool init();
+    void cleanup();
+
+    void clear() { commands.clear(); }
+    void reserve(size_t count) { commands.reserve(count); }
+    // Adjacent instances of the same mesh merge into one instanced draw
+    void add(const ArenaMesh& mesh, GLuint firstInstance, GLuint instanceCount = 1);
+    size_t size() const { return commands.size(); }
+
+    // Returns the number of GL draw calls issued
+    size_t submit(const GeometryArena& arena) const;
+    bool usesIndirect() const { return indirect; }
+
+private:
+    std::vector<DrawElementsIndirectCommand> commands;
+    GLuint indirectBuffer = 0;
+    mutable size_t indirectCapacity = 0;
+    bool indirect = false;
+
+    // Scratch arrays for the 3.3 path
+    mutable std::vector<GLsizei> counts;
+    mutable std::vector<const void*> offsets;
+    mutable std::vector<GLint> baseVertices;
+
+    size_t submitIndirect() const;
+    size_t submitBaseVertex(const GeometryArena& arena) const;
+};
+
+#endif /* geometry_arena_hpp */
@@ -0,0 +1,368 @@
+//
+//  gltf_loader.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/15/25.
+//
+
+#include "gltf_loader.hpp"
+#include "json.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+namespace {
+
+constexpr uint32_t kGlbMagic = 0x46546c67;    // "glTF"
+constexpr uint32_t kChunkJson = 0x4e4f534a;   // "JSON"
+constexpr uint32_t kChunkBin = 0x004e4942;    // "BIN\0"
+
+// glTF component types are the GL enums
+constexpr long long kUnsignedByte = GL_UNSIGNED_BYTE;
+constexpr long long kUnsignedShort = GL_UNSIGNED_SHORT;
+constexpr long long kUnsignedInt = GL_UNSIGNED_INT;
+constexpr long long kFloat = GL_FLOAT;
+// Largest byteStride the glTF spec allows
+constexpr long long kMaxStride = 252;
+
+// GLB is little-endian, like every host we build for
+uint32_t readU32(const char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+struct AccessorRange {
+    size_t offset = 0;     // bytes into the BIN chunk
+    size_t end = 0;        // one past the last byte read
+    GLsizei stride = 0;
+    GLint components = 0;
+    GLenum type = 0;
+    GLboolean normalized = GL_FALSE;
+    size_t count = 0;
+};
+
+int componentCount(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    return 0;
+}
+
+size_t componentSize(long long type) {
+    switch (type) {
+    case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+    case GL_SHORT: case GL_UNSIGNED_SHORT: return 2;
+    case GL_UNSIGNED_INT: case GL_FLOAT: return 4;
+    default: return 0;
+    }
+}
+
+// Locates an accessor's bytes in the BIN chunk without touching them
+bool resolveAccessor(const JsonValue& root, long long index, size_t binSize, AccessorRange& range, const char*& error) {
+    const JsonValue& accessor = root["accessors"][static_cast<size_t>(index)];
+    if (index < 0 || !accessor.isObject())
+        return (error = "missing accessor"), false;
+    if (accessor.has("sparse"))
+        return (error = "sparse accessors are not supported"), false;
+
+    long long viewIndex = accessor["bufferView"].asIndex();
+    const JsonValue& view = root["bufferViews"][static_cast<size_t>(viewIndex)];
+    if (viewIndex < 0 || !view.isObject())
+        return (error = "accessor without a buffer view"), false;
+    const JsonValue& buffer = root["buffers"][static_cast<size_t>(view["buffer"].asIndex(0))];
+    if (view["buffer"].asIndex(0) != 0 || buffer.has("uri"))
+        return (error = "only the embedded GLB buffer is supported"), false;
+
+    range.components = componentCount(accessor["type"].asString());
+    range.type = static_cast<GLenum>(accessor["componentType"].asIndex(0));
+    range.normalized = accessor["normalized"].asBool() ? GL_TRUE : GL_FALSE;
+    range.count = static_cast<size_t>(std::max(accessor["count"].asIndex(0), 0LL));
+    size_t elementSize = range.components * componentSize(range.type);
+    if (elementSize == 0 || range.count == 0)
+        return (error = "empty or unknown accessor type"), false;
+
+    // GL reads a stride of 0 as tightly packed, so the range check has to see the real one
+    long long stride = view.has("byteStride") ? view["byteStride"].asIndex() : 0;
+    if (stride == 0)
+        stride = static_cast<long long>(elementSize);
+    if (stride < static_cast<long long>(elementSize) || stride > kMaxStride)
+        return (error = "invalid byteStride"), false;
+
+    size_t viewOffset = static_cast<size_t>(view["byteOffset"].asIndex(0));
+    size_t viewEnd = viewOffset + static_cast<size_t>(view["byteLength"].asIndex(0));
+    range.stride = static_cast<GLsizei>(stride);
+    range.offset = viewOffset + static_cast<size_t>(accessor["byteOffset"].asIndex(0));
+    range.end = range.offset + static_cast<size_t>(range.stride) * (range.count - 1) + elementSize;
+    if (range.end > viewEnd || viewEnd > binSize || range.offset % componentSize(range.type) != 0)
+        return (error = "accessor outside its buffer view or misaligned"), false;
+    return true;
+}
+
+template <typename T>
+size_t maxIndexOf(const char* data, size_t count) {
+    size_t result = 0;
+    for (size_t i = 0; i < count; ++i) {
+        T value;
+        std::memcpy(&value, data + i * sizeof(T), sizeof(T));
+        result = std::max<size_t>(result, value);
+    }
+    return result;
+}
+
+// The GPU would fetch whatever an out-of-range index points at, so the indices are the one
+// accessor read on the CPU
+size_t maxIndex(const char* data, GLenum type, size_t count) {
+    if (type == GL_UNSIGNED_BYTE)
+        return maxIndexOf<uint8_t>(data, count);
+    if (type == GL_UNSIGNED_SHORT)
+        return maxIndexOf<uint16_t>(data, count);
+    return maxIndexOf<uint32_t>(data, count);
+}
+
+glm::dmat4 nodeTransform(const JsonValue& node) {
+    const JsonValue& matrix = node["matrix"];
+    if (matrix.size() == 16) {
+        glm::dmat4 result(1.0);
+        for (int column = 0; column < 4; ++column) {
+            for (int row = 0; row < 4; ++row)
+                result[column][row] = matrix[column * 4 + row].asNumber();
+        }
+        return result;
+    }
+
+    const JsonValue& t = node["translation"];
+    const JsonValue& r = node["rotation"];
+    const JsonValue& s = node["scale"];
+    double x = r[0].asNumber(0.0), y = r[1].asNumber(0.0), z = r[2].asNumber(0.0), w = r[3].asNumber(1.0);
+
+    // T * R * S, the rotation quaternion expanded column by column
+    glm::dmat4 result(1.0);
+    result[0] = glm::dvec4(1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y + z * w), 2.0 * (x * z - y * w), 0.0) * s[0].asNumber(1.0);
+    result[1] = glm::dvec4(2.0 * (x * y - z * w), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z + x * w), 0.0) * s[1].asNumber(1.0);
+    result[2] = glm::dvec4(2.0 * (x * z + y * w), 2.0 * (y * z - x * w), 1.0 - 2.0 * (x * x + y * y), 0.0) * s[2].asNumber(1.0);
+    result[3] = glm::dvec4(t[0].asNumber(0.0), t[1].asNumber(0.0), t[2].asNumber(0.0), 1.0);
+    return result;
+}
+
+}
+
+bool GltfAsset::load(const std::string& path) {
+    release();
+    if (!file.open(path, MappedFile::Access::Sequential))
+        return false;
+
+    const char* data = file.data();
+    size_t size = file.size();
+    if (size < 20 || readU32(data) != kGlbMagic || readU32(data + 4) != 2) {
+        std::cerr << path << ": not a binary glTF 2.0 file\n";
+        release();
+        return false;
+    }
+
+    // Header, then 4-byte aligned chunks: JSON first, the optional BIN second
+    size_t length = std::min<size_t>(readU32(data + 8), size);
+    const char* json = nullptr;
+    const char* bin = nullptr;
+    size_t jsonLength = 0, binLength = 0;
+    for (size_t offset = 12; offset + 8 <= length;) {
+        size_t chunkLength = readU32(data + offset);
+        uint32_t chunkType = readU32(data + offset + 4);
+        if (offset + 8 + chunkLength > length)
+            break;
+        if (chunkType == kChunkJson && !json) {
+            json = data + offset + 8;
+            jsonLength = chunkLength;
+        } else if (chunkType == kChunkBin && !bin) {
+            bin = data + offset + 8;
+            binLength = chunkLength;
+        }
+        offset += 8 + ((chunkLength + 3) & ~size_t(3));
+    }
+
+    JsonValue root;
+    std::string jsonError;
+    if (!json || !parseJson(json, jsonLength, root, jsonError)) {
+        std::cerr << path << ": invalid JSON chunk" << (jsonError.empty() ? "" : ", ") << jsonError << "\n";
+        release();
+        return false;
+    }
+
+    const JsonValue& meshes = root["meshes"];
+    std::vector<std::vector<uint32_t>> meshPrimitives(meshes.size());
+    size_t skipped = 0;
+    const char* firstProblem = nullptr;
+    for (size_t m = 0; m < meshes.size(); ++m) {
+        const JsonValue& meshPrimitivesJson = meshes[m]["primitives"];
+        for (size_t p = 0; p < meshPrimitivesJson.size(); ++p) {
+            const JsonValue& primitive = meshPrimitivesJson[p];
+            const JsonValue& attributes = primitive["attributes"];
+            const char* error = nullptr;
+
+            AccessorRange position, index, color;
+            bool hasColor = attributes.has("COLOR_0");
+            bool usable = true;
+            if (primitive["mode"].asIndex(4) != 4) {
+                error = "only triangle lists are supported";
+                usable = false;
+            } else if (!primitive.has("indices")) {
+                error = "only indexed primitives are supported";
+                usable = false;
+            } else {
+                usable = resolveAccessor(root, attributes["POSITION"].asIndex(), binLength, position, error)
+                      && resolveAccessor(root, primitive["indices"].asIndex(), binLength, index, error)
+                      && (!hasColor || resolveAccessor(root, attributes["COLOR_0"].asIndex(), binLength, color, error));
+            }
+            if (usable && (position.components != 3 || position.type != kFloat)) {
+                error = "POSITION must be float VEC3";
+                usable = false;
+            }
+            if (usable && (index.components != 1 || index.stride != static_cast<GLsizei>(componentSize(index.type))
+                           || (index.type != kUnsignedByte && index.type != kUnsignedShort && index.type != kUnsignedInt))) {
+                error = "indices must be tightly packed unsigned integers";
+                usable = false;
+            }
+            if (usable && maxIndex(bin + index.offset, index.type, index.count) >= position.count) {
+                error = "indices reference vertices past the POSITION count";
+                usable = false;
+            }
+            if (usable && hasColor && (color.components < 3 || (color.type != kFloat && !color.normalized))) {
+                error = "COLOR_0 must be float or normalized RGB/RGBA";
+                usable = false;
+            }
+            if (!usable) {
+                if (!firstProblem)
+                    firstProblem = error;
+                ++skipped;
+                continue;
+            }
+
+            // Each accessor's own bytes, starts kept 4-aligned; interleaved attributes share a span.
+            // Exporters often put all vertices before all indices, so one span over every
+            // accessor would upload most of the BIN chunk for every primitive
+            std::vector<std::pair<size_t, size_t>> ranges = { { position.offset & ~size_t(3), position.end },
+                                                              { index.offset & ~size_t(3), index.end } };
+            if (hasColor)
+                ranges.push_back({ color.offset & ~size_t(3), color.end });
+            std::sort(ranges.begin(), ranges.end());
+
+            GltfPrimitive result;
+            ExternalGeometry& geometry = result.geometry;
+            geometry.data = bin;
+            size_t spanEnd = 0;
+            for (const std::pair<size_t, size_t>& range : ranges) {
+                if (geometry.spanCount > 0 && range.first < spanEnd) {
+                    spanEnd = std::max(spanEnd, range.second);
+                } else {
+                    geometry.spans[geometry.spanCount++].offset = range.first;
+                    spanEnd = range.second;
+                }
+                geometry.spans[geometry.spanCount - 1].size = spanEnd - geometry.spans[geometry.spanCount - 1].offset;
+            }
+            geometry.position = { 3, GL_FLOAT, GL_FALSE, position.stride, static_cast<GLintptr>(position.offset) };
+            if (hasColor)
+                geometry.color = { 3, color.type, color.normalized, color.stride, static_cast<GLintptr>(color.offset) };
+            geometry.indexType = index.type;
+            geometry.indexOffset = static_cast<GLintptr>(index.offset);
+            geometry.indexCount = static_cast<GLsizei>(index.count);
+            geometry.vertexCount = static_cast<GLsizei>(position.count);
+
+            // POSITION min/max are mandatory, the scan only covers files that omit them anyway
+            const JsonValue& accessor = root["accessors"][static_cast<size_t>(attributes["POSITION"].asIndex())];
+            const JsonValue& low = accessor["min"];
+            const JsonValue& high = accessor["max"];
+            if (low.size() == 3 && high.size() == 3) {
+                geometry.bounds.min = glm::vec3(low[0].asNumber(), low[1].asNumber(), low[2].asNumber());
+                geometry.bounds.max = glm::vec3(high[0].asNumber(), high[1].asNumber(), high[2].asNumber());
+            } else {
+                for (size_t v = 0; v < position.count; ++v) {
+                    glm::vec3 point;
+                    std::memcpy(&point, bin + position.offset + v * position.stride, sizeof(point));
+                    expandBounds(geometry.bounds, point);
+                }
+            }
+
+            const JsonValue& factor = root["materials"][static_cast<size_t>(primitive["material"].asIndex(0))]["pbrMetallicRoughness"]["baseColorFactor"];
+            if (primitive.has("material") && factor.size() == 4)
+                result.baseColor = glm::vec4(factor[0].asNumber(), factor[1].asNumber(), factor[2].asNumber(), factor[3].asNumber());
+
+            result.mesh = static_cast<uint32_t>(m);
+            meshPrimitives[m].push_back(static_cast<uint32_t>(primitives.size()));
+            primitives.push_back(result);
+        }
+    }
+    if (skipped > 0)
+        std::cerr << path << ": skipped " << skipped << " primitive(s), first because " << firstProblem << "\n";
+    if (primitives.empty()) {
+        std::cerr << path << ": no drawable primitives\n";
+        release();
+        return false;
+    }
+
+    // Roots of the default scene, or every node nobody lists as a child
+    const JsonValue& nodes = root["nodes"];
+    std::vector<size_t> roots;
+    const JsonValue& scene = root["scenes"][static_cast<size_t>(root["scene"].asIndex(0))];
+    if (scene.isObject()) {
+        for (size_t i = 0; i < scene["nodes"].size(); ++i)
+            roots.push_back(static_cast<size_t>(scene["nodes"][i].asIndex(0)));
+    } else {
+        std::vector<bool> isChild(nodes.size(), false);
+        for (size_t n = 0; n < nodes.size(); ++n) {
+            for (size_t c = 0; c < nodes[n]["children"].size(); ++c) {
+                size_t child = static_cast<size_t>(nodes[n]["children"][c].asIndex(0));
+                if (child < isChild.size())
+                    isChild[child] = true;
+            }
+        }
+        for (size_t n = 0; n < nodes.size(); ++n) {
+            if (!isChild[n])
+                roots.push_back(n);
+        }
+    }
+
+    // Depth-first with accumulated transforms; the depth cap guards against cyclic files
+    struct Pending { size_t node; glm::dmat4 parent; size_t depth; };
+    std::vector<Pending> stack;
+    for (size_t rootNode : roots)
+        stack.push_back({ rootNode, glm::dmat4(1.0), 0 });
+    while (!stack.empty()) {
+        Pending pending = stack.back();
+        stack.pop_back();
+        const JsonValue& node = nodes[pending.node];
+        if (!node.isObject() || pending.depth > nodes.size())
+            continue;
+
+        glm::dmat4 transform = pending.parent * nodeTransform(node);
+        long long mesh = node["mesh"].asIndex();
+        if (mesh >= 0 && static_cast<size_t>(mesh) < meshPrimitives.size()) {
+            for (uint32_t primitive : meshPrimitives[static_cast<size_t>(mesh)])
+                instances.push_back({ primitive, transform });
+        }
+        for (size_t c = 0; c < node["children"].size(); ++c)
+            stack.push_back({ static_cast<size_t>(node["children"][c].asIndex(0)), transform, pending.depth + 1 });
+    }
+
+    // A file with meshes but no nodes still shows them
+    if (instances.empty()) {
+        for (uint32_t p = 0; p < primitives.size(); ++p)
+            instances.push_back({ p, glm::dmat4(1.0) });
+    }
+    return true;
+}
+
+void GltfAsset::release() {
+    file.close();
+    primitives.clear();
+    instances.clear();
+}
+
+BoundingBox GltfAsset::getSceneBounds() const {
+    BoundingBox bounds;
+    for (const GltfInstance& instance : instances)
+        expandBounds(bounds, transformBounds(primitives[instance.primitive].geometry.bounds, glm::mat4(instance.transform)));
+    return bounds;
+}
@@ -0,0 +1,57 @@
+//
+//  gltf_loader.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/15/25.
+//
+
+#ifndef gltf_loader_hpp
+#define gltf_loader_hpp
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+#include "mapped_file.hpp"
+
+// One triangle primitive of a glTF mesh, pointing into the mapped file
+struct GltfPrimitive {
+    ExternalGeometry geometry;
+    glm::vec4 baseColor = glm::vec4(1.0f);   // material baseColorFactor
+    uint32_t mesh = 0;                       // index into the file's meshes
+};
+
+// A primitive placed by a node of the default scene, transform accumulated from the root
+struct GltfInstance {
+    uint32_t primitive = 0;
+    glm::dmat4 transform = glm::dmat4(1.0);
+};
+
+// Binary glTF 2.0 (.glb) reader. The file stays memory-mapped and every primitive's geometry
+// is described as an ExternalGeometry over the BIN chunk, so Mesh::init uploads accessor data
+// straight from the mapping with no CPU-side vertex copy. Supports indexed triangle primitives
+// with float POSITION and optional COLOR_0 (float, normalized unsigned byte or short); other
+// primitives, sparse accessors and external buffers are skipped with a warning.
+class GltfAsset {
+public:
+    bool load(const std::string& path);
+    // Unmaps the file; the geometry pointers are invalid afterwards, call after uploading
+    void release();
+
+    const std::vector<GltfPrimitive>& getPrimitives() const { return primitives; }
+    const std::vector<GltfInstance>& getInstances() const { return instances; }
+    // Union of the instance bounds in scene space
+    BoundingBox getSceneBounds() const;
+
+private:
+    MappedFile file;
+    std::vector<GltfPrimitive> primitives;
+    std::vector<GltfInstance> instances;
+};
+
+#endif /* gltf_loader_hpp */
@@ -0,0 +1,187 @@
+//
+//  id_buffer.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/10/25.
+//
+
+#include "id_buffer.hpp"
+#include "shader_utils.hpp"
+#include "object_constants.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+const char* kVertexShaderSource = R"(
+    #version 330 core
+    layout(location = 0) in vec3 aPos;
+    layout(location = 2) in mat4 aInstanceModel;
+    layout(std140) uniform ObjectBlock {
+        mat4 uModelViewProjection;
+        mat4 uModelView;
+        uvec4 uObject;
+    };
+    flat out uint vObjectId;
+
+    void main() {
+        vObjectId = uObject.x + uint(gl_InstanceID);
+        gl_Position = uModelViewProjection * aInstanceModel * vec4(aPos, 1.0);
+    }
+)";
+
+// Each instance is its own object. IDs are stored +1 so a cleared pixel (0) means nothing was hit
+const char* kFragmentShaderSource = R"(
+    #version 330 core
+    flat in uint vObjectId;
+    out uvec2 FragId;
+
+    void main() {
+        FragId = uvec2(vObjectId + 1u, uint(gl_PrimitiveID));
+    }
+)";
+
+}
+
+bool IdBuffer::init(int w, int h) {
+    width = std::max(w, 1);
+    height = std::max(h, 1);
+
+    program = buildProgram(kVertexShaderSource, nullptr, kFragmentShaderSource);
+    if (!program)
+        return false;
+    ObjectConstantsRing::bindUniformBlock(program);
+
+    for (Readback& slot : ring) {
+        glGenBuffers(1, &slot.PBO);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+        glBufferData(GL_PIXEL_PACK_BUFFER, 2 * sizeof(GLuint), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    glGenFramebuffers(1, &FBO);
+    glGenRenderbuffers(1, &idRBO);
+    glGenRenderbuffers(1, &depthRBO);
+    return allocate();
+}
+
+void IdBuffer::resize(int w, int h) {
+    w = std::max(w, 1);
+    h = std::max(h, 1);
+    if (w == width && h == height)
+        return;
+
+    width = w;
+    height = h;
+    allocate();
+}
+
+bool IdBuffer::allocate() {
+    glBindRenderbuffer(GL_RENDERBUFFER, idRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RG32UI, width, height);
+
+    // Same depth format as the scene target, so either depth convention works here
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, idRBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!complete)
+        std::cerr << "ID buffer " << width << "x" << height << " is incomplete\n";
+    return complete;
+}
+
+void IdBuffer::cleanup() {
+    for (Readback& slot : ring) {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.PBO);
+        slot = Readback();
+    }
+    writeSlot = readSlot = inFlight = 0;
+
+    glDeleteProgram(program);
+    glDeleteFramebuffers(1, &FBO);
+    glDeleteRenderbuffers(1, &idRBO);
+    glDeleteRenderbuffers(1, &depthRBO);
+    program = FBO = idRBO = depthRBO = 0;
+}
+
+bool IdBuffer::begin(int x, int y) {
+    if (!program || inFlight == kRingSize)
+        return false;
+    if (x < 0 || y < 0 || x >= width || y >= height)
+        return false;
+
+    pixelX = x;
+    pixelY = height - 1 - y;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glViewport(0, 0, width, height);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(pixelX, pixelY, 1, 1);
+
+    const GLuint clearId[4] = { 0, 0, 0, 0 };
+    glClearBufferuiv(GL_COLOR, 0, clearId);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(program);
+    return true;
+}
+
+void IdBuffer::draw(const Mesh& mesh) const {
+    mesh.draw();
+}
+
+void IdBuffer::end() {
+    Readback& slot = ring[writeSlot];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glReadPixels(pixelX, pixelY, 1, 1, GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    writeSlot = (writeSlot + 1) % kRingSize;
+    ++inFlight;
+
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+}
+
+bool IdBuffer::poll(IdSample& sample) {
+    bool updated = false;
+
+    // Slots complete in order, stop at the first one the GPU has not reached yet
+    while (inFlight > 0) {
+        Readback& slot = ring[readSlot];
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+        const GLuint* id = static_cast<const GLuint*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 2 * sizeof(GLuint), GL_MAP_READ_BIT));
+        if (id) {
+            sample.hit = id[0] != 0;
+            sample.object = sample.hit ? id[0] - 1 : 0;
+            sample.triangle = id[1];
+            updated = true;
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        readSlot = (readSlot + 1) % kRingSize;
+        --inFlight;
+    }
+    return updated;
+}
@@ -0,0 +1,65 @@
+//
+//  id_buffer.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/10/25.
+//
+
+#ifndef id_buffer_hpp
+#define id_buffer_hpp
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+
+#include "mesh.hpp"
+
+struct IdSample {
+    bool hit = false;
+    uint32_t object = 0;
+    uint32_t triangle = 0;
+};
+
+// Integer object/triangle ID target for GPU picking. Only the pixel under the cursor is
+// rasterized (scissor) and read back through a ring of PBOs guarded by fences, so results
+// arrive a frame or two late but the render thread never waits on glReadPixels.
+class IdBuffer {
+public:
+    static constexpr int kRingSize = 3;
+
+    bool init(int width, int height);
+    void resize(int width, int height);
+    void cleanup();
+
+    // Starts an ID pass for framebuffer pixel (x, y), top-left origin. Returns false when the
+    // pixel is off-target or every readback slot is still in flight; skip the pass then.
+    bool begin(int x, int y);
+    // Transform and object ID come from the bound ObjectBlock; instance i reports object ID + i
+    void draw(const Mesh& mesh) const;
+    // Queues the asynchronous readback and restores the default framebuffer
+    void end();
+
+    // Collects finished readbacks without blocking; true when sample holds a newer result
+    bool poll(IdSample& sample);
+
+private:
+    struct Readback {
+        GLuint PBO = 0;
+        GLsync fence = nullptr;
+    };
+
+    GLuint FBO = 0, idRBO = 0, depthRBO = 0;
+    GLuint program = 0;
+    int width = 0, height = 0;
+
+    Readback ring[kRingSize];
+    int writeSlot = 0;     // next slot to queue
+    int readSlot = 0;      // oldest slot in flight
+    int inFlight = 0;
+    int pixelX = 0, pixelY = 0;
+
+    bool allocate();
+};
+
+#endif /* id_buffer_hpp */
@@ -5,7 +5,17 @@
 //  Created by Danil Rostov on 4/21/25.
 //
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -16,16 +26,65 @@
 
 #include "camera.hpp"
 #include "mesh.hpp"
+#include "render_target.hpp"
+#include "benchmark.hpp"
+#include "multi_view.hpp"
+#include "picking.hpp"
+#include "id_buffer.hpp"
+#include "geometry_arena.hpp"
+#include "obj_loader.hpp"
+#include "mesh_cache.hpp"
+#include "gltf_loader.hpp"
+#include "ply_loader.hpp"
+#include "point_cloud.hpp"
+#include "mesh_chunks.hpp"
+#include "chunk_streamer.hpp"
+#include "meshlet_culling.hpp"
+#include "stream_buffer.hpp"
+#include "object_constants.hpp"
 #include "matrix_utils.hpp"
+#include "shader_utils.hpp"
+#include "parallel.hpp"
 
 Camera* gCamera = nullptr;  // Global camera pointer
 
-glm::mat4 gModelMatrix = glm::mat4(1.0f); // Identity matrix
+glm::dmat4 gModelMatrix = glm::dmat4(1.0); // Identity matrix, double precision world transform
+
+int gFramebufferWidth = 0, gFramebufferHeight = 0;
+
+// Right-click pick queued by the mouse callback, in framebuffer pixels
+bool gPickRequested = false;
+double gPickX = 0.0, gPickY = 0.0;
+
+// Cursor position for GPU hover picking, in framebuffer pixels; invalid while ImGui owns the mouse
+bool gHoverValid = false;
+double gHoverX = 0.0, gHoverY = 0.0;
+
+enum class PickMode
+{
+    CpuRay,       // BVH ray cast on right-click
+    GpuIdBuffer   // ID pass under the cursor every frame, right-click selects the hovered triangle
+};
 
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void cursorPosCallback(GLFWwindow* window, double xpos, double ypos);
+void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 //void applyTransformMatrix();
-void renderMatrixEditor(float* inputMatrix, bool& applyMatrix);
+void renderMatrixEditor(double* inputMatrix, bool& applyMatrix);
+void renderCullingStats(const CullStats& stats);
+void renderLodControls(const Mesh& mesh, float& maxPixelError, int& forcedLod, double pixelsPerUnit);
+void renderMeshletControls(bool& meshletCulling, bool& coneCulling, bool active, const Mesh& mesh, const MeshletCullStats& stats);
+void renderPointCloudControls(const PointCloud& pointCloud, const PlyPointReader& reader, float& pointSize);
+void renderStreamingStats(const ChunkStreamer& streamer);
+void renderPickingInfo(PickMode& mode, const PickResult& pick, bool hit, double pickMicroseconds, const IdSample& hover);
+void toFramebufferPixels(GLFWwindow* window, double xpos, double ypos, double& x, double& y);
+bool renderInstanceControls(int& gridSize, bool& perObjectDraws, bool& deform, bool deformAvailable, bool perObjectAvailable, const Mesh& mesh, const GeometryArena& arena, const DrawList& drawList, size_t drawCalls);
+std::vector<Instance> buildInstanceGrid(int gridSize, float spacing);
+void frameBounds(Camera& camera, const BoundingBox& bounds);
+void deformVertices(const std::vector<Vertex>& source, float time, std::vector<Vertex>& deformed);
+void registerPickObjects(ScenePicker& picker, const TriangleBvh& meshBvh, const Mesh& mesh, const glm::dmat4& model);
+void renderCameraControls(Camera& camera, const MultiView& multiView, bool& multiViewEnabled);
+void configureDepth(bool reversedZ, bool clipControlSupported);
 
 GLuint createShaderProgram()
 {
@@ -33,47 +92,185 @@ GLuint createShaderProgram()
         #version 330 core
         layout(location = 0) in vec3 aPos;
         layout(location = 1) in vec3 aColor;
+        layout(location = 2) in mat4 aInstanceModel;
+        layout(location = 6) in vec4 aInstanceColor;
         out vec3 vColor;
-        uniform mat4 uProjection;
-        uniform mat4 uView;
-        uniform mat4 uModel;
-    
+        flat out int vInstance;
+        layout(std140) uniform CameraBlock {
+            mat4 uView;
+            mat4 uProjection;
+            mat4 uViewProjection;
+            mat4 uInverseView;
+            mat4 uInverseProjection;
+            mat4 uInverseViewProjection;
+            vec4 uEyePosition;
+            vec4 uViewport;
+        };
+        layout(std140) uniform ObjectBlock {
+            mat4 uModelViewProjection; // composed in double on the CPU
+            mat4 uModelView;
+            uvec4 uObject;
+        };
+
         void main() {
-            vColor = aColor;
-            gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0);
+            vColor = aColor * aInstanceColor.rgb;
+            vInstance = gl_InstanceID;
+            gl_Position = uModelViewProjection * aInstanceModel * vec4(aPos, 1.0);
         }
     )";
 
     const char *fragmentShaderSource = R"(
         #version 330 core
         in vec3 vColor;
+        flat in int vInstance;
         out vec4 FragColor;
+        uniform ivec2 uHighlight; // instance, triangle; -1 when nothing is hovered
         void main() {
-            FragColor = vec4(vColor, 1.0);
+            vec3 color = vColor;
+            if (vInstance == uHighlight.x && gl_PrimitiveID == uHighlight.y)
+                color = mix(color, vec3(1.0), 0.6);
+            FragColor = vec4(color, 1.0);
         }
     )";
 
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
+    GLuint shaderProgram = buildProgram(vertexShaderSource, nullptr, fragmentShaderSource);
 
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
+    Camera::bindUniformBlock(shaderProgram);
+    ObjectConstantsRing::bindUniformBlock(shaderProgram);
 
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
+    return shaderProgram;
+}
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+struct BenchmarkOptions
+{
+    bool enabled = false;
+    std::string pathFile;   // empty runs the built-in orbit
+    std::string outputFile; // empty writes to stdout
+    int frames = 1000;
+};
 
-    return shaderProgram;
+struct SceneOptions
+{
+    MeshOptions mesh;
+    std::string meshFile;   // OBJ, GLB, PLY point cloud or chunk file to show instead of the cube
+    bool meshCache = true;  // reuse/write <meshFile>.meshcache for OBJ imports
+    std::string chunkOutput;    // convert the OBJ to a chunk file and exit
+    size_t residencyMb = 512;   // resident geometry budget when streaming a chunk file
+};
+
+std::string fileExtension(const std::string& path);
+
+bool loadSceneMesh(const SceneOptions& scene, Mesh& mesh, std::vector<Mesh>& extraMeshes, BoundingBox& sceneBounds, glm::dvec3& sceneOrigin);
+bool loadGltfScene(const SceneOptions& scene, Mesh& mesh, std::vector<Mesh>& extraMeshes, BoundingBox& sceneBounds, glm::dvec3& sceneOrigin);
+
+bool parseArguments(int argc, char** argv, BenchmarkOptions& options, SceneOptions& scene)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--benchmark") == 0)
+        {
+            options.enabled = true;
+            if (hasValue && argv[i + 1][0] != '-')
+                options.pathFile = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && hasValue)
+        {
+            options.frames = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--output") == 0 && hasValue)
+        {
+            options.outputFile = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--quantize") == 0)
+        {
+            scene.mesh.vertexFormat = VertexFormat::Quantized;
+        }
+        else if (std::strcmp(argv[i], "--optimize") == 0)
+        {
+            scene.mesh.optimize = true;
+        }
+        else if (std::strcmp(argv[i], "--lod") == 0)
+        {
+            scene.mesh.generateLods = true;
+        }
+        else if (std::strcmp(argv[i], "--meshlets") == 0)
+        {
+            scene.mesh.meshlets = true;
+        }
+        else if (std::strcmp(argv[i], "--mesh") == 0 && hasValue)
+        {
+            scene.meshFile = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--no-cache") == 0)
+        {
+            scene.meshCache = false;
+        }
+        else if (std::strcmp(argv[i], "--write-chunks") == 0 && hasValue)
+        {
+            scene.chunkOutput = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--residency-mb") == 0 && hasValue)
+        {
+            scene.residencyMb = static_cast<size_t>(std::max(std::atoi(argv[++i]), 1));
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--benchmark [camera_path.txt]] [--frames N] [--output report.json] [--quantize] [--optimize] [--lod] [--meshlets] [--mesh model.obj|model.glb|scan.ply|model.chunks] [--no-cache] [--write-chunks out.chunks] [--residency-mb N]\n";
+            return false;
+        }
+    }
+
+    if (options.frames < 2)
+    {
+        std::cerr << "--frames must be at least 2\n";
+        return false;
+    }
+    if (!scene.chunkOutput.empty() && fileExtension(scene.meshFile) != ".obj")
+    {
+        std::cerr << "--write-chunks converts an OBJ given with --mesh\n";
+        return false;
+    }
+    return true;
 }
 
-int main()
+// Offline step for out-of-core viewing: the model is loaded once here, the viewer then only
+// maps the chunk file and keeps --residency-mb of it resident
+int convertToChunks(const SceneOptions& scene)
 {
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    auto progress = [&scene](float fraction) {
+        std::cout << "\rLoading " << scene.meshFile << ": " << static_cast<int>(100.0f * fraction) << "%" << std::flush;
+    };
+    bool loaded = loadObj(scene.meshFile, vertices, indices, progress);
+    std::cout << "\n";
+    if (!loaded)
+    {
+        std::cerr << "Failed to load " << scene.meshFile << "\n";
+        return -1;
+    }
+    return writeChunkFile(scene.chunkOutput, vertices, indices) ? 0 : -1;
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions benchmark;
+    SceneOptions scene;
+    if (!parseArguments(argc, argv, benchmark, scene))
+        return -1;
+    if (!scene.chunkOutput.empty())
+        return convertToChunks(scene);
+
+    CameraPath cameraPath;
+    if (benchmark.enabled)
+    {
+        if (benchmark.pathFile.empty())
+            cameraPath.setDefaultOrbit();
+        else if (!cameraPath.load(benchmark.pathFile))
+            return -1;
+    }
+
     if (!glfwInit())
     {
         std::cerr << "Failed to initialize GLFW\n";
@@ -92,6 +289,10 @@ int main()
         return -1;
     }
     glfwMakeContextCurrent(window);
+
+    // Benchmark frames must not be paced by the display
+    if (benchmark.enabled)
+        glfwSwapInterval(0);
     
     // Init ImGui
     IMGUI_CHECKVERSION();
@@ -103,8 +304,13 @@ int main()
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330");
     
-    glfwSetMouseButtonCallback(window, mouseButtonCallback);
-    glfwSetCursorPosCallback(window, cursorPosCallback);
+    // Benchmark runs follow the scripted path only, so mouse input never reaches the camera
+    if (!benchmark.enabled)
+    {
+        glfwSetMouseButtonCallback(window, mouseButtonCallback);
+        glfwSetCursorPosCallback(window, cursorPosCallback);
+    }
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
     if (glewInit() != GLEW_OK)
     {
@@ -114,29 +320,179 @@ int main()
     
     glEnable(GL_DEPTH_TEST);
 
+    // Reversed-Z needs [0, 1] clip depth, GL 3.3 contexts fall back to standard depth
+    bool clipControlSupported = GLEW_VERSION_4_5 || GLEW_ARB_clip_control;
+    bool depthReversed = false;
+
     GLuint shaderProgram = createShaderProgram();
+    if (!shaderProgram)
+    {
+        std::cerr << "Failed to build the scene shader\n";
+        return -1;
+    }
     
     // Setup camera
     Camera camera;
     camera.lookAt(
-        glm::vec3(2.0f, 2.0f, 2.0f),   // eye from top-right corner
-        glm::vec3(0.0f, 0.0f, 0.0f),   // center
-        glm::vec3(0.0f, 1.0f, 0.0f)    // up
+        glm::dvec3(2.0, 2.0, 2.0),   // eye from top-right corner
+        glm::dvec3(0.0, 0.0, 0.0),   // center
+        glm::dvec3(0.0, 1.0, 0.0)    // up
     );
+    camera.setClipControlSupported(clipControlSupported);
     gCamera = &camera;  // Assign global camera pointer
 
-    // Setup mesh
+    glfwGetFramebufferSize(window, &gFramebufferWidth, &gFramebufferHeight);
+    camera.setViewport(gFramebufferWidth, gFramebufferHeight);
+
+    // Float depth target used while reversed-Z is active
+    RenderTarget sceneTarget;
+    sceneTarget.init(gFramebufferWidth, gFramebufferHeight);
+
+    // Top/front/side views synchronized with the interactive camera
+    MultiView multiView;
+    if (!multiView.init(&camera))
+        std::cerr << "Multi-view shaders failed to build, multi-view disabled\n";
+    bool multiViewEnabled = false;
+
+    // Setup mesh, falling back to the cube when the file does not load
+    // glTF files can hold several primitives: the first is the interactive mesh, the rest are
+    // extra meshes that are drawn but not culled, picked or streamed
     Mesh mesh;
-    mesh.init();
+    std::vector<Mesh> extraMeshes;
+    BoundingBox sceneBounds;
+    // Far-off geometry is loaded relative to this point; it joins gModelMatrix in double, so
+    // only small offsets are ever rounded to float
+    glm::dvec3 sceneOrigin(0.0);
+    glm::dmat4 originTransform(1.0);
+    bool pointCloudFile = fileExtension(scene.meshFile) == ".ply";
+    bool chunkFile = fileExtension(scene.meshFile) == ".chunks";
+    if (!scene.meshFile.empty() && !pointCloudFile && !chunkFile && loadSceneMesh(scene, mesh, extraMeshes, sceneBounds, sceneOrigin))
+        frameBounds(camera, sceneBounds);
+    else
+        mesh.init(scene.mesh);
+
+    // Point clouds replace the mesh view and stream in over many frames: the reader decodes on
+    // its own thread and the render loop uploads a few chunks per frame, drawing what has arrived
+    PlyPointReader pointReader;
+    PointCloud pointCloud;
+    bool pointMode = false;
+    float pointSize = 0.0f;   // world units, suggested by the first chunk
+    if (pointCloudFile) {
+        pointMode = pointReader.open(scene.meshFile) && pointCloud.init(pointReader.getPointCount());
+        if (pointMode) {
+            sceneOrigin = pointReader.getOrigin();
+            pointReader.start();
+        } else {
+            std::cerr << "Failed to load " << scene.meshFile << ", showing the cube instead\n";
+        }
+    }
+    const int kPointChunksPerFrame = 4;
+    originTransform[3] = glm::dvec4(sceneOrigin, 1.0);
+
+    // Chunk files replace the mesh view too; only the chunks worth seeing from the current and the
+    // predicted eye are resident, within the --residency-mb budget
+    ChunkStreamer streamer;
+    bool streamMode = false;
+    if (chunkFile) {
+        streamMode = streamer.open(scene.meshFile, scene.residencyMb << 20);
+        if (streamMode)
+            frameBounds(camera, transformBounds(streamer.getBounds(), glm::mat4(gModelMatrix)));
+        else
+            std::cerr << "Failed to load " << scene.meshFile << ", showing the cube instead\n";
+    }
+    bool sceneReplaced = pointMode || streamMode;
+    auto pointLoadStart = std::chrono::steady_clock::now();
+    glm::vec3 meshSize = mesh.getBounds().max - mesh.getBounds().min;
+    const float gridSpacing = 1.5f * std::max(meshSize.x, std::max(meshSize.y, meshSize.z));
+
+    // Setup culling
+    CullingSet cullingSet;
+    uint32_t meshCullIndex = cullingSet.addBox(mesh.getInstanceBounds());
+    std::vector<uint64_t> visibility;
+
+    // Setup picking
+    TriangleBvh meshBvh;
+    meshBvh.build(mesh);
+    // Instance i of the mesh is pickable object i, in both picking modes
+    ScenePicker scenePicker;
+    registerPickObjects(scenePicker, meshBvh, mesh, gModelMatrix * originTransform);
+    PickResult pick;
+    bool pickHit = false;
+    double pickMicroseconds = 0.0;
+
+    PickMode pickMode = PickMode::CpuRay;
+    IdBuffer idBuffer;
+    if (!idBuffer.init(gFramebufferWidth, gFramebufferHeight))
+        std::cerr << "ID buffer failed to initialize, GPU picking disabled\n";
+    IdSample hover;
+    const GLint highlightLoc = glGetUniformLocation(shaderProgram, "uHighlight");
+
+    int instanceGrid = 1;
+
+    // Screen-space error LOD selection, forcedLod >= 0 pins a level
+    float maxPixelError = 1.0f;
+    int forcedLod = -1;
+
+    // Shared arena: every grid cube becomes its own culled draw, submitted through one draw list.
+    // It holds a second copy of the mesh, sized to fit, so it is only built once per-object
+    // culling is switched on. GPU-only meshes (glTF) have no CPU copy to place in it.
+    GeometryArena arena;
+    ArenaMesh arenaCube;
+    DrawList drawList;
+    bool arenaAvailable = !mesh.getIndices().empty() && !sceneReplaced;
+    bool arenaReady = false;
+    bool perObjectDraws = false;
+    CullingSet instanceCulling;
+    instanceCulling.addBox(mesh.getBounds());
+    std::vector<uint64_t> instanceVisibility;
+    size_t arenaDrawCalls = 0;
+
+    // Meshlet culling refines the per-object path: visible instances are split into meshlet ranges
+    MeshletCuller meshletCuller;
+    MeshletCullStats meshletStats;
+    std::vector<uint32_t> visibleInstances;
+    bool meshletCulling = true, coneCulling = true;
+
+    // Per-frame vertex data (the deform toggle) streams through a fenced ring, built with room
+    // for the whole mesh once deforming is switched on. Quantized and GPU-only meshes have no
+    // float vertices to stream.
+    StreamBuffer vertexStream;
+    bool deformAvailable = !mesh.getVertices().empty() && mesh.getVertexFormat() != VertexFormat::Quantized && !sceneReplaced;
+    bool vertexStreamReady = false;
+    bool deformMesh = false, meshDeformed = false;
+    std::vector<Vertex> deformedVertices;
+
+    // Per-draw matrices and IDs, selected with glBindBufferRange
+    ObjectConstantsRing objectConstants;
+    if (!objectConstants.init(1024))
+    {
+        std::cerr << "Failed to allocate the per-draw constant buffer\n";
+        glfwTerminate();
+        return -1;
+    }
+
+    FrameTimer frameTimer;
+    int benchmarkFrame = 0;
+    if (benchmark.enabled)
+        frameTimer.init();
 
     while (!glfwWindowShouldClose(window))
     {
+        if (benchmark.enabled)
+        {
+            cameraPath.apply(camera, static_cast<float>(benchmarkFrame) / (benchmark.frames - 1));
+            frameTimer.beginFrame();
+        }
+
+        vertexStream.beginFrame();
+        objectConstants.beginFrame();
+
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
         // ImGui window
-        static float inputMatrix[16] = {
+        static double inputMatrix[16] = {
             1, 0, 0, 0,
             0, 1, 0, 0,
             0, 0, 1, 0,
@@ -145,28 +501,297 @@ int main()
         static bool applyMatrix = false;
 
         renderMatrixEditor(inputMatrix, applyMatrix);
+        renderCameraControls(camera, multiView, multiViewEnabled);
+        bool instancesChanged = renderInstanceControls(instanceGrid, perObjectDraws, deformMesh, deformAvailable, arenaAvailable, mesh, arena, drawList, arenaDrawCalls);
         
-        if (applyMatrix) {
+        if (instancesChanged) {
+            mesh.setInstances(buildInstanceGrid(instanceGrid, gridSpacing));
+            if (arenaReady)
+                arena.setInstances(mesh.getInstances());
+            // Placeholder boxes, refreshed every frame in camera-relative space
+            instanceCulling.clear();
+            instanceCulling.reserve(mesh.getInstanceCount());
+            for (size_t i = 0; i < mesh.getInstanceCount(); ++i)
+                instanceCulling.addBox(mesh.getBounds());
+        }
+
+        if (perObjectDraws && !arenaReady && arenaAvailable) {
+            uint32_t vertexCount = static_cast<uint32_t>(mesh.getVertices().size());
+            uint32_t indexCount = static_cast<uint32_t>(mesh.getIndices().size());
+            arenaReady = arena.init(OffsetAllocator::capacityFor(vertexCount), OffsetAllocator::capacityFor(indexCount), mesh.getInstanceCount())
+                      && arena.add(mesh, arenaCube) && drawList.init();
+            if (arenaReady) {
+                arena.setInstances(mesh.getInstances());
+            } else {
+                std::cerr << "Failed to build the geometry arena, per-object culling disabled\n";
+                arena.cleanup();
+                arenaAvailable = perObjectDraws = false;
+            }
+        }
+
+        if (deformMesh && !vertexStreamReady) {
+            vertexStreamReady = vertexStream.init(GL_ARRAY_BUFFER, mesh.getVertices().size() * sizeof(Vertex));
+            if (!vertexStreamReady) {
+                std::cerr << "Failed to allocate the vertex stream, deforming disabled\n";
+                vertexStream.cleanup();
+                deformAvailable = deformMesh = false;
+            }
+        }
+
+        if (applyMatrix)
             gModelMatrix = glm::transpose(glm::make_mat4(inputMatrix));
+
+        if (applyMatrix || instancesChanged) {
+            registerPickObjects(scenePicker, meshBvh, mesh, gModelMatrix * originTransform);
             applyMatrix = false;
         }
+        glm::dmat4 sceneModel = gModelMatrix * originTransform;
+
+        // Fold this frame's queued cursor moves into a single arcball rotation
+        camera.update();
+
+        // The orthographic views use standard depth, so multi-view disables reversed-Z; the
+        // primary camera falls back with it, keeping its projection and frustum on the same depth
+        camera.setClipControlSupported(clipControlSupported && !multiViewEnabled);
+
+        if (multiViewEnabled) {
+            multiView.update();
+            multiView.setViewport(gFramebufferWidth, gFramebufferHeight);
+        } else {
+            camera.setViewport(gFramebufferWidth, gFramebufferHeight);
+        }
+
+        // Reject off-screen meshes before issuing any GL calls for them
+        // Bounds are tested in camera-relative space, like the frustum
+        BoundingBox meshRelativeBounds = transformBounds(mesh.getInstanceBounds(), camera.getRelativeModelMatrix(sceneModel));
+        cullingSet.setBox(meshCullIndex, meshRelativeBounds);
+        CullStats cullStats;
+        if (multiViewEnabled)
+            multiView.cull(cullingSet, visibility, &cullStats);
+        else
+            cullingSet.cull(camera.getFrustum(), visibility, &cullStats);
+
+        // Per-object path: cull every instance and emit one arena draw per visible run
+        bool arenaDraw = perObjectDraws && arenaReady && !multiViewEnabled && !sceneReplaced;
+        if (arenaDraw) {
+            glm::mat4 relativeModel = camera.getRelativeModelMatrix(sceneModel);
+            const std::vector<Instance>& instances = mesh.getInstances();
+            for (uint32_t i = 0; i < instances.size(); ++i)
+                instanceCulling.setBox(i, transformBounds(arenaCube.bounds, relativeModel * instances[i].model));
+            instanceCulling.cull(camera.getFrustum(), instanceVisibility, &cullStats);
+
+            drawList.clear();
+            if (meshletCulling && !mesh.getMeshlets().empty()) {
+                visibleInstances.clear();
+                for (uint32_t i = 0; i < instances.size(); ++i) {
+                    if (CullingSet::isVisible(instanceVisibility, i))
+                        visibleInstances.push_back(i);
+                }
+                meshletCuller.cull(mesh.getMeshlets(), arenaCube, instances, visibleInstances, relativeModel,
+                                   camera.getFrustum(), coneCulling, drawList, &meshletStats);
+            } else {
+                for (uint32_t i = 0; i < instances.size(); ++i) {
+                    if (CullingSet::isVisible(instanceVisibility, i))
+                        drawList.add(arenaCube, i);
+                }
+            }
+        }
+        renderCullingStats(cullStats);
+        renderMeshletControls(meshletCulling, coneCulling, arenaDraw, mesh, meshletStats);
+
+        // The nearest point of the bounds sets the scale for every instance; LOD errors are in
+        // mesh units, so the model matrix's largest axis scale converts them to world units
+        glm::vec3 nearestPoint = glm::min(glm::max(glm::vec3(0.0f), meshRelativeBounds.min), meshRelativeBounds.max);
+        double modelScale = std::max({ glm::length(glm::dvec3(gModelMatrix[0])), glm::length(glm::dvec3(gModelMatrix[1])),
+                                       glm::length(glm::dvec3(gModelMatrix[2])) });
+        double pixelsPerUnit = camera.getPixelsPerUnit(glm::length(nearestPoint)) * modelScale;
+        mesh.setLod(forcedLod >= 0 ? static_cast<size_t>(forcedLod) : mesh.selectLod(pixelsPerUnit, maxPixelError));
+        renderLodControls(mesh, maxPixelError, forcedLod, pixelsPerUnit);
+
+        // Picking uses the full-window camera, multi-view quadrants, point clouds and streamed
+        // models are not pickable
+        bool gpuPicking = pickMode == PickMode::GpuIdBuffer && !multiViewEnabled && !sceneReplaced;
+        if (gpuPicking) {
+            // Latest finished readback, one or two frames behind the cursor
+            idBuffer.poll(hover);
+            if (!gHoverValid)
+                hover = IdSample();
+        } else {
+            hover = IdSample();
+        }
+
+        if (gPickRequested && !multiViewEnabled && !sceneReplaced) {
+            auto pickStart = std::chrono::steady_clock::now();
+            if (gpuPicking) {
+                pickHit = hover.hit;
+                pick = PickResult();
+                pick.object = hover.hit ? static_cast<int>(hover.object) : -1;
+                pick.triangle = hover.triangle;
+            } else {
+                glm::dvec3 rayOrigin, rayDirection;
+                camera.screenToRay(gPickX, gPickY, rayOrigin, rayDirection);
+                pickHit = scenePicker.pick(rayOrigin, rayDirection, pick);
+            }
+            pickMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - pickStart).count();
+        }
+        gPickRequested = false;
+        renderPickingInfo(pickMode, pick, pickHit, pickMicroseconds, hover);
+
+        bool reversedZ = camera.isReversedZ();
+        if (reversedZ != depthReversed) {
+            configureDepth(reversedZ, clipControlSupported);
+            depthReversed = reversedZ;
+        }
+
+        if (deformMesh) {
+            deformVertices(mesh.getVertices(), static_cast<float>(glfwGetTime()), deformedVertices);
+            meshDeformed = mesh.streamVertices(vertexStream, deformedVertices);
+            vertexStream.flush();
+            if (!meshDeformed) {
+                std::cerr << "Could not stream the deformed vertices, deforming disabled\n";
+                deformAvailable = deformMesh = false;
+            }
+        } else if (meshDeformed) {
+            mesh.useStaticVertices();
+            meshDeformed = false;
+        }
+
+        if (pointMode && !pointReader.isFinished()) {
+            PlyPointChunk chunk;
+            for (int i = 0; i < kPointChunksPerFrame && pointReader.poll(chunk); ++i) {
+                bool firstChunk = pointCloud.getPointCount() == 0;
+                pointCloud.append(chunk.points, chunk.bounds);
+                if (firstChunk) {
+                    frameBounds(camera, transformBounds(chunk.bounds, glm::mat4(sceneModel)));
+                    pointSize = pointCloud.getSuggestedPointSize();
+                }
+            }
+            if (pointReader.isFinished()) {
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - pointLoadStart).count();
+                std::cout << "Streamed " << pointCloud.getPointCount() << " points in " << seconds << " s\n";
+            }
+        }
+        if (pointMode)
+            renderPointCloudControls(pointCloud, pointReader, pointSize);
+
+        // Streamed models are shown in the single view only, ranking needs the one eye
+        if (streamMode && !multiViewEnabled)
+            streamer.update(camera, gModelMatrix);
+        if (streamMode)
+            renderStreamingStats(streamer);
+
+        // One constants slot serves both the ID pass and the scene pass; the camera block is
+        // written from the same camera state before either pass reads it
+        bool meshVisible = CullingSet::isVisible(visibility, meshCullIndex) && !sceneReplaced;
+        if (!multiViewEnabled) {
+            camera.apply();
+            ObjectConstants meshConstants = makeObjectConstants(camera, sceneModel, 0);
+            objectConstants.bind(objectConstants.upload(&meshConstants, 1), 0);
+        }
+
+        // ID pass: only the hovered pixel is rasterized, the result is read back asynchronously
+        if (gpuPicking && gHoverValid) {
+            idBuffer.resize(gFramebufferWidth, gFramebufferHeight);
+            if (idBuffer.begin(static_cast<int>(gHoverX), static_cast<int>(gHoverY))) {
+                if (meshVisible)
+                    idBuffer.draw(mesh);
+                idBuffer.end();
+            }
+        }
+
+        if (reversedZ) {
+            sceneTarget.resize(camera.getViewportWidth(), camera.getViewportHeight());
+            sceneTarget.bind();
+        }
 
         // Draw scene
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glUseProgram(shaderProgram);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "uModel"), 1, GL_FALSE, glm::value_ptr(gModelMatrix));
-        camera.apply(shaderProgram);
-        mesh.draw();
+        if (multiViewEnabled) {
+            if (meshVisible)
+                multiView.draw(mesh, sceneModel);
+            for (const Mesh& extra : extraMeshes)
+                multiView.draw(extra, sceneModel);
+        } else {
+            glUseProgram(shaderProgram);
+            // gl_InstanceID restarts for every arena draw, so hover highlighting needs the mesh path
+            if (hover.hit && !arenaDraw)
+                glUniform2i(highlightLoc, static_cast<GLint>(hover.object), static_cast<GLint>(hover.triangle));
+            else
+                glUniform2i(highlightLoc, -1, -1);
+            if (pointMode)
+                pointCloud.draw(camera, pointSize, modelScale);
+            else if (streamMode)
+                streamer.draw();
+            else if (arenaDraw)
+                arenaDrawCalls = drawList.submit(arena);
+            else if (meshVisible)
+                mesh.draw();
+            if (!extraMeshes.empty()) {
+                glUniform2i(highlightLoc, -1, -1);
+                for (const Mesh& extra : extraMeshes)
+                    extra.draw();
+            }
+        }
+
+        if (reversedZ)
+            sceneTarget.blitToScreen();
+
+        // Fence this frame's arena removals and recycle ranges the GPU is done with
+        arena.endFrame();
+        streamer.endFrame();
+        vertexStream.endFrame();
+        objectConstants.endFrame();
         
         // Render UI
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+        if (benchmark.enabled)
+        {
+            frameTimer.endFrame();
+            if (++benchmarkFrame >= benchmark.frames)
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    int exitCode = 0;
+    if (benchmark.enabled)
+    {
+        frameTimer.finish();
+        if (benchmark.outputFile.empty())
+        {
+            if (!writeBenchmarkReport(std::cout, frameTimer, benchmarkFrame))
+                exitCode = 1;
+        }
+        else
+        {
+            std::ofstream report(benchmark.outputFile);
+            if (!writeBenchmarkReport(report, frameTimer, benchmarkFrame))
+            {
+                std::cerr << "Failed to write the benchmark report to " << benchmark.outputFile << "\n";
+                exitCode = 1;
+            }
+        }
+        frameTimer.cleanup();
+    }
+
+    pointReader.close();
+    pointCloud.cleanup();
+    streamer.close();
     mesh.cleanup();
+    for (Mesh& extra : extraMeshes)
+        extra.cleanup();
+    camera.cleanup();
+    multiView.cleanup();
+    sceneTarget.cleanup();
+    idBuffer.cleanup();
+    arena.cleanup();
+    drawList.cleanup();
+    vertexStream.cleanup();
+    objectConstants.cleanup();
 
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -174,7 +799,7 @@ int main()
 
     glfwDestroyWindow(window);
     glfwTerminate();
-    return 0;
+    return exitCode;
 }
 
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
@@ -197,6 +822,12 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
     {
         if (gCamera) gCamera->setDragging(false);
     }
+
+    if (action == GLFW_PRESS && button == GLFW_MOUSE_BUTTON_RIGHT)
+    {
+        toFramebufferPixels(window, xpos, ypos, gPickX, gPickY);
+        gPickRequested = true;
+    }
 }
 
 void cursorPosCallback(GLFWwindow* window, double xpos, double ypos)
@@ -204,14 +835,183 @@ void cursorPosCallback(GLFWwindow* window, double xpos, double ypos)
     // Forward to ImGui
     ImGui_ImplGlfw_CursorPosCallback(window, xpos, ypos);
     
-    if (ImGui::GetIO().WantCaptureMouse)
+    gHoverValid = !ImGui::GetIO().WantCaptureMouse;
+    if (!gHoverValid)
         return;
 
+    toFramebufferPixels(window, xpos, ypos, gHoverX, gHoverY);
+
     if (gCamera)
         gCamera->onMouseMove(static_cast<int>(xpos), static_cast<int>(ypos));
 }
 
-void renderMatrixEditor(float* inputMatrix, bool& applyMatrix) {
+void framebufferSizeCallback(GLFWwindow* /*window*/, int width, int height)
+{
+    glViewport(0, 0, width, height);
+    gFramebufferWidth = width;
+    gFramebufferHeight = height;
+
+    if (gCamera)
+        gCamera->setViewport(width, height);
+}
+
+// Cursor positions are in screen coordinates, picking works in framebuffer pixels
+void toFramebufferPixels(GLFWwindow* window, double xpos, double ypos, double& x, double& y)
+{
+    int windowWidth, windowHeight;
+    glfwGetWindowSize(window, &windowWidth, &windowHeight);
+    x = xpos * gFramebufferWidth / std::max(windowWidth, 1);
+    y = ypos * gFramebufferHeight / std::max(windowHeight, 1);
+}
+
+// Cubes on a regular grid around the model origin, tinted by position
+std::vector<Instance> buildInstanceGrid(int gridSize, float spacing)
+{
+    const float half = 0.5f * (gridSize - 1);
+
+    std::vector<Instance> instances;
+    instances.reserve(static_cast<size_t>(gridSize) * gridSize * gridSize);
+    for (int z = 0; z < gridSize; ++z) {
+        for (int y = 0; y < gridSize; ++y) {
+            for (int x = 0; x < gridSize; ++x) {
+                Instance instance;
+                instance.model = glm::translate(glm::mat4(1.0f), spacing * glm::vec3(x - half, y - half, z - half));
+                if (gridSize > 1)
+                    instance.color = glm::vec4(glm::vec3(x, y, z) * (0.6f / float(gridSize - 1)) + 0.4f, 1.0f);
+                instances.push_back(instance);
+            }
+        }
+    }
+    return instances;
+}
+
+bool loadSceneMesh(const SceneOptions& scene, Mesh& mesh, std::vector<Mesh>& extraMeshes, BoundingBox& sceneBounds, glm::dvec3& sceneOrigin)
+{
+    if (fileExtension(scene.meshFile) == ".glb")
+        return loadGltfScene(scene, mesh, extraMeshes, sceneBounds, sceneOrigin);
+
+    // The cache holds the finished mesh (optimized, LODs, meshlets), keyed by the OBJ's content
+    auto start = std::chrono::steady_clock::now();
+    std::string cachePath = scene.meshFile + ".meshcache";
+    uint64_t sourceHash = 0;
+    bool cacheable = scene.meshCache && hashFile(scene.meshFile, sourceHash);
+    if (cacheable && loadMeshCache(cachePath, scene.mesh, sourceHash, mesh))
+    {
+        std::cout << "Loaded " << mesh.getIndices().size() / 3 << " triangles from " << cachePath << " in "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s\n";
+        sceneBounds = mesh.getBounds();
+        return true;
+    }
+
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    ObjLoadStats stats;
+    auto progress = [&scene](float fraction) {
+        std::cout << "\rLoading " << scene.meshFile << ": " << static_cast<int>(100.0f * fraction) << "%" << std::flush;
+    };
+
+    bool loaded = loadObj(scene.meshFile, vertices, indices, progress, &stats);
+    std::cout << "\n";
+    if (!loaded)
+    {
+        std::cerr << "Failed to load " << scene.meshFile << ", showing the cube instead\n";
+        return false;
+    }
+
+    std::cout << "Loaded " << stats.triangles << " triangles, " << stats.positions << " positions welded to "
+              << stats.weldedVertices << " vertices in " << stats.seconds << " s on " << workerCount() << " threads\n";
+    mesh.init(std::move(vertices), std::move(indices), scene.mesh);
+    sceneBounds = mesh.getBounds();
+    if (cacheable && writeMeshCache(cachePath, mesh, scene.mesh, sourceHash))
+        std::cout << "Wrote " << cachePath << "\n";
+    return true;
+}
+
+// Every primitive becomes a mesh uploaded straight from the mapped file, its node placements
+// become instances tinted with the material's base color. Placements are relative to the scene's
+// center, which comes back as sceneOrigin for the double model matrix.
+bool loadGltfScene(const SceneOptions& scene, Mesh& mesh, std::vector<Mesh>& extraMeshes, BoundingBox& sceneBounds, glm::dvec3& sceneOrigin)
+{
+    auto start = std::chrono::steady_clock::now();
+    GltfAsset asset;
+    if (!asset.load(scene.meshFile))
+    {
+        std::cerr << "Failed to load " << scene.meshFile << ", showing the cube instead\n";
+        return false;
+    }
+    if (scene.mesh.optimize || scene.mesh.generateLods || scene.mesh.meshlets || scene.mesh.vertexFormat != VertexFormat::Float)
+        std::cerr << "--optimize, --lod, --meshlets and --quantize do not apply to glTF models\n";
+
+    const std::vector<GltfPrimitive>& primitives = asset.getPrimitives();
+    // Node transforms are taken to the scene's center in double before they become float
+    // instance matrices, so georeferenced translations do not cost float precision
+    sceneBounds = asset.getSceneBounds();
+    sceneOrigin = sceneBounds.isEmpty() ? glm::dvec3(0.0) : glm::dvec3(sceneBounds.center());
+    glm::dmat4 toOrigin(1.0);
+    toOrigin[3] = glm::dvec4(-sceneOrigin, 1.0);
+    std::vector<std::vector<Instance>> placements(primitives.size());
+    for (const GltfInstance& instance : asset.getInstances())
+        placements[instance.primitive].push_back({ glm::mat4(toOrigin * instance.transform), primitives[instance.primitive].baseColor });
+
+    size_t uploadedBytes = 0;
+    bool first = true;
+    for (size_t p = 0; p < primitives.size(); ++p)
+    {
+        if (placements[p].empty())
+            continue;
+        Mesh& target = first ? mesh : (extraMeshes.emplace_back(), extraMeshes.back());
+        target.init(primitives[p].geometry);
+        target.setInstances(placements[p]);
+        uploadedBytes += primitives[p].geometry.getUploadSize();
+        first = false;
+    }
+    size_t placementCount = asset.getInstances().size();
+    asset.release();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Loaded " << extraMeshes.size() + 1 << " primitives, " << placementCount << " placements, "
+              << uploadedBytes / (1024.0 * 1024.0) << " MB uploaded in " << seconds << " s\n";
+    return true;
+}
+
+// Lowercase, dot included; empty when the name has none
+std::string fileExtension(const std::string& path)
+{
+    std::string extension = path.substr(std::min(path.size(), path.rfind('.')));
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+// Looks at the bounds from the same diagonal as the default view, with the limits scaled to fit
+void frameBounds(Camera& camera, const BoundingBox& bounds)
+{
+    if (bounds.isEmpty())
+        return;
+    glm::dvec3 center = glm::dvec3(bounds.center());
+    double radius = std::max(static_cast<double>(glm::length(bounds.extent())), 1e-3);
+    camera.setScale(radius);
+    camera.lookAt(center + glm::dvec3(1.8 * radius), center, glm::dvec3(0.0, 1.0, 0.0));
+}
+
+// Breathing wobble, recomputed on the CPU every frame to exercise vertex streaming
+void deformVertices(const std::vector<Vertex>& source, float time, std::vector<Vertex>& deformed)
+{
+    deformed.resize(source.size());
+    for (size_t i = 0; i < source.size(); ++i) {
+        float scale = 1.0f + 0.15f * std::sin(3.0f * time + 2.0f * source[i].position.y);
+        deformed[i].position = source[i].position * scale;
+        deformed[i].color = source[i].color;
+    }
+}
+
+void registerPickObjects(ScenePicker& picker, const TriangleBvh& meshBvh, const Mesh& mesh, const glm::dmat4& model)
+{
+    picker.clear();
+    for (const Instance& instance : mesh.getInstances())
+        picker.addObject(&meshBvh, model * glm::dmat4(instance.model));
+}
+
+void renderMatrixEditor(double* inputMatrix, bool& applyMatrix) {
     ImGui::Begin("Matrix Editor", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
 
     ImGui::SetWindowSize(ImVec2(300, 0), ImGuiCond_FirstUseEver);
@@ -220,7 +1020,7 @@ void renderMatrixEditor(float* inputMatrix, bool& applyMatrix) {
 
     for (int row = 0; row < 4; ++row) {
         ImGui::PushID(row);
-        ImGui::InputFloat4("", &inputMatrix[row * 4]);
+        ImGui::InputScalarN("", ImGuiDataType_Double, &inputMatrix[row * 4], 4, nullptr, nullptr, "%.3f");
         ImGui::PopID();
     }
 
@@ -232,3 +1032,167 @@ void renderMatrixEditor(float* inputMatrix, bool& applyMatrix) {
 
     ImGui::End();
 }
+
+void renderCullingStats(const CullStats& stats) {
+    ImGui::Begin("Culling", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    ImGui::Text("Tested:  %zu", stats.tested);
+    ImGui::Text("Visible: %zu", stats.visible);
+    ImGui::Text("Culled:  %zu", stats.culled());
+    ImGui::End();
+}
+
+void renderLodControls(const Mesh& mesh, float& maxPixelError, int& forcedLod, double pixelsPerUnit) {
+    const std::vector<MeshLod>& lods = mesh.getLods();
+    if (lods.size() < 2)
+        return;
+
+    ImGui::Begin("Level of detail", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    ImGui::SliderFloat("Max error (px)", &maxPixelError, 0.1f, 16.0f, "%.1f");
+    ImGui::SliderInt("Force LOD", &forcedLod, -1, static_cast<int>(lods.size()) - 1, forcedLod < 0 ? "auto" : "%d");
+
+    for (size_t i = 0; i < lods.size(); ++i) {
+        ImGui::Text("%s LOD %zu: %7d triangles, error %.2f px", i == mesh.getLod() ? ">" : " ", i,
+                    lods[i].indexCount / 3, lods[i].error * pixelsPerUnit);
+    }
+    ImGui::End();
+}
+
+void renderPointCloudControls(const PointCloud& pointCloud, const PlyPointReader& reader, float& pointSize) {
+    ImGui::Begin("Point cloud", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    ImGui::Text("Points: %zu / %zu", pointCloud.getPointCount(), pointCloud.getCapacity());
+    if (!reader.isFinished())
+        ImGui::ProgressBar(static_cast<float>(reader.getDecodedPoints()) / static_cast<float>(std::max<size_t>(pointCloud.getCapacity(), 1)));
+    float suggested = std::max(pointCloud.getSuggestedPointSize(), 1e-6f);
+    ImGui::SliderFloat("Point size", &pointSize, 0.1f * suggested, 10.0f * suggested, "%.4g", ImGuiSliderFlags_Logarithmic);
+    ImGui::End();
+}
+
+void renderStreamingStats(const ChunkStreamer& streamer) {
+    const StreamingStats& stats = streamer.getStats();
+    ImGui::Begin("Streaming", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    ImGui::Text("Resident:  %zu / %zu chunks", stats.residentChunks, streamer.getChunkCount());
+    ImGui::ProgressBar(static_cast<float>(stats.residentBytes) / static_cast<float>(std::max<size_t>(streamer.getBudget(), 1)));
+    ImGui::Text("Budget:    %.1f / %zu MB", stats.residentBytes / (1024.0 * 1024.0), streamer.getBudget() >> 20);
+    ImGui::Text("Wanted:    %zu chunks", stats.wantedChunks);
+    ImGui::Text("Pending:   %zu loads", stats.pendingLoads);
+    ImGui::Text("Drawn:     %zu chunks", stats.drawnChunks);
+    ImGui::Text("Loads:     %zu, evictions %zu", stats.loads, stats.evictions);
+    ImGui::End();
+}
+
+void renderMeshletControls(bool& meshletCulling, bool& coneCulling, bool active, const Mesh& mesh, const MeshletCullStats& stats) {
+    if (mesh.getMeshlets().empty())
+        return;
+
+    ImGui::Begin("Meshlets", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    ImGui::Text("Meshlets: %zu per instance", mesh.getMeshlets().size());
+    ImGui::Checkbox("Meshlet culling", &meshletCulling);
+    ImGui::Checkbox("Back-face cones", &coneCulling);
+
+    if (!active) {
+        ImGui::TextDisabled("Enable per-object culling to cull meshlets");
+    } else if (meshletCulling) {
+        ImGui::Text("Tested:     %zu", stats.tested);
+        ImGui::Text("Frustum:    %zu culled", stats.frustumCulled);
+        ImGui::Text("Back-face:  %zu culled", stats.coneCulled);
+        ImGui::Text("Triangles:  %zu drawn", stats.visibleTriangles);
+    }
+    ImGui::End();
+}
+
+void renderPickingInfo(PickMode& mode, const PickResult& pick, bool hit, double pickMicroseconds, const IdSample& hover) {
+    ImGui::Begin("Picking", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+    const char* modes[] = { "CPU ray (BVH)", "GPU ID buffer" };
+    int current = static_cast<int>(mode);
+    if (ImGui::Combo("Mode", &current, modes, IM_ARRAYSIZE(modes)))
+        mode = static_cast<PickMode>(current);
+
+    ImGui::TextDisabled("Right-click to pick");
+    if (mode == PickMode::GpuIdBuffer) {
+        if (hover.hit)
+            ImGui::Text("Hover:    object %u, triangle %u", hover.object, hover.triangle);
+        else
+            ImGui::Text("Hover:    none");
+    }
+
+    if (hit) {
+        ImGui::Text("Object:   %d", pick.object);
+        ImGui::Text("Triangle: %u", pick.triangle);
+        // The ID buffer only knows what was hit, not where
+        if (mode == PickMode::CpuRay) {
+            ImGui::Text("Distance: %.4f", pick.distance);
+            ImGui::Text("Hit:      %.3f %.3f %.3f", pick.position.x, pick.position.y, pick.position.z);
+        }
+    } else {
+        ImGui::Text("No hit");
+    }
+    ImGui::Text("Query:    %.2f us", pickMicroseconds);
+    ImGui::End();
+}
+
+bool renderInstanceControls(int& gridSize, bool& perObjectDraws, bool& deform, bool deformAvailable, bool perObjectAvailable, const Mesh& mesh, const GeometryArena& arena, const DrawList& drawList, size_t drawCalls) {
+    ImGui::Begin("Instances", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    bool changed = ImGui::SliderInt("Grid", &gridSize, 1, 50);
+
+    ImGui::BeginDisabled(!deformAvailable);
+    ImGui::Checkbox("Deform (streamed vertices)", &deform);
+    ImGui::EndDisabled();
+    if (perObjectAvailable)
+        ImGui::Checkbox("Per-object culling (arena)", &perObjectDraws);
+
+    if (perObjectDraws && perObjectAvailable) {
+        ImGui::Text("Instances: %zu, draws: %zu", mesh.getInstanceCount(), drawList.size());
+        ImGui::Text("GL calls:  %zu (%s)", drawCalls, drawList.usesIndirect() ? "multi-draw indirect" : "multi-draw base vertex");
+
+        OffsetAllocator::StorageReport vertexReport = arena.getVertexAllocator().storageReport();
+        OffsetAllocator::StorageReport indexReport = arena.getIndexAllocator().storageReport();
+        ImGui::Text("Arena vertices: %u free, %.1f%% fragmented", vertexReport.totalFree, 100.0f * vertexReport.fragmentation());
+        ImGui::Text("Arena indices:  %u free, %.1f%% fragmented", indexReport.totalFree, 100.0f * indexReport.fragmentation());
+    } else {
+        ImGui::Text("Instances: %zu (one draw call)", mesh.getInstanceCount());
+    }
+    ImGui::End();
+    return changed;
+}
+
+void renderCameraControls(Camera& camera, const MultiView& multiView, bool& multiViewEnabled) {
+    ImGui::Begin("Camera", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+    if (multiView.isReady()) {
+        ImGui::Checkbox("Multi-view", &multiViewEnabled);
+        if (multiViewEnabled) {
+            ImGui::SameLine();
+            ImGui::TextDisabled(multiView.usesViewportArray() ? "(viewport array)" : "(per-view passes)");
+        }
+    }
+
+    const char* projectionNames[] = { "Perspective", "Orthographic", "Reversed-Z" };
+    int projection = static_cast<int>(camera.getProjectionType());
+    if (ImGui::Combo("Projection", &projection, projectionNames, IM_ARRAYSIZE(projectionNames))) {
+        camera.setProjectionType(static_cast<Camera::ProjectionType>(projection));
+    }
+
+    if (camera.getProjectionType() == Camera::ProjectionType::ReversedZ && !camera.isReversedZ()) {
+        ImGui::TextDisabled(multiViewEnabled ? "Multi-view uses standard depth" : "glClipControl unavailable, using standard depth");
+    }
+
+    ImGui::End();
+}
+
+void configureDepth(bool reversedZ, bool clipControlSupported)
+{
+    if (reversedZ)
+    {
+        glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+        glDepthFunc(GL_GREATER);
+        glClearDepth(0.0);
+    }
+    else
+    {
+        if (clipControlSupported)
+            glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+        glDepthFunc(GL_LESS);
+        glClearDepth(1.0);
+    }
+}
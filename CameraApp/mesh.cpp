@@ -6,8 +6,17 @@
 //
 
 #include "mesh.hpp"
+#include "stream_buffer.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
 
-void Mesh::init() {
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+void Mesh::init(const MeshOptions& options) {
     vertices = {
         {{-1, -1, -1}, {1, 0, 0}},  // 0 - Red
         {{ 1, -1, -1}, {0, 1, 0}},  // 1 - Green
@@ -28,6 +37,34 @@ void Mesh::init() {
         0, 1, 5, 5, 4, 0   // bottom face
     };
 
+    upload(options);
+}
+
+void Mesh::init(std::vector<Vertex> vertexData, std::vector<GLuint> indexData, const MeshOptions& options) {
+    vertices = std::move(vertexData);
+    indices = std::move(indexData);
+    upload(options);
+}
+
+void Mesh::upload(const MeshOptions& options) {
+    vertexFormat = options.vertexFormat;
+    if (options.optimize)
+        optimizeGeometry();
+
+    // Meshlets grow from the cache order, so they come after optimizing and before the LODs
+    meshlets.clear();
+    if (options.meshlets && !vertices.empty()) {
+        buildMeshlets(indices, &vertices[0].position, sizeof(Vertex), vertices.size(), meshlets);
+        std::cout << "Built " << meshlets.size() << " meshlets, " << static_cast<float>(indices.size() / 3) / std::max<size_t>(meshlets.size(), 1)
+                  << " triangles each on average\n";
+    }
+
+    bounds = BoundingBox();
+    for (const Vertex& vertex : vertices)
+        expandBounds(bounds, vertex.position);
+
+    std::vector<GLuint> lodIndices = buildLods(options);
+
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
@@ -35,25 +72,408 @@ void Mesh::init() {
     glBindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    if (vertexFormat == VertexFormat::Quantized) {
+        std::vector<PackedVertex> packed = quantizeVertices();
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    }
 
+    // 16-bit indices whenever every vertex is addressable with them
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    if (vertices.size() <= 0x10000) {
+        std::vector<GLushort> shortIndices(lodIndices.begin(), lodIndices.end());
+        indexType = GL_UNSIGNED_SHORT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort), shortIndices.data(), GL_STATIC_DRAW);
+    } else {
+        indexType = GL_UNSIGNED_INT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, lodIndices.size() * sizeof(GLuint), lodIndices.data(), GL_STATIC_DRAW);
+    }
 
-    // Set Position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    // Set Position and Color
+    setVertexSource(VBO, 0, vertexFormat);
     glEnableVertexAttribArray(0);
-    
-    // Set Color
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, color)); // Color
     glEnableVertexAttribArray(1);
 
+    createInstanceBuffer();
     glBindVertexArray(0);
+
+    setInstances({ Instance() });
 }
 
-void Mesh::draw() const {
+void Mesh::init(const ExternalGeometry& geometry) {
+    vertices.clear();
+    indices.clear();
+    meshlets.clear();
+    vertexFormat = VertexFormat::Float;
+    indexType = geometry.indexType;
+    bounds = geometry.bounds;
+
+    // Spans are packed 4-aligned, so offsets keep their alignment when moved into the buffer
+    size_t bufferOffsets[ExternalGeometry::kMaxSpans];
+    size_t bufferSize = 0;
+    for (size_t i = 0; i < geometry.spanCount; ++i) {
+        bufferOffsets[i] = bufferSize;
+        bufferSize += (geometry.spans[i].size + 3) & ~size_t(3);
+    }
+    auto toBuffer = [&](GLintptr offset) {
+        for (size_t i = 0; i < geometry.spanCount; ++i) {
+            const ExternalSpan& span = geometry.spans[i];
+            if (static_cast<size_t>(offset) >= span.offset && static_cast<size_t>(offset) < span.offset + span.size)
+                return static_cast<GLintptr>(bufferOffsets[i] + (offset - span.offset));
+        }
+        return offset;
+    };
+
+    size_t indexSize = indexType == GL_UNSIGNED_BYTE ? 1 : indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    lods.assign(1, MeshLod{ static_cast<GLuint>(toBuffer(geometry.indexOffset) / indexSize), geometry.indexCount, 0.0f });
+    currentLod = 0;
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+
+    // Straight from the caller's memory into the one buffer; EBO stays 0 because VBO is both
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_STATIC_DRAW);
+    for (size_t i = 0; i < geometry.spanCount; ++i)
+        glBufferSubData(GL_ARRAY_BUFFER, bufferOffsets[i], geometry.spans[i].size, geometry.data + geometry.spans[i].offset);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, VBO);
+
+    const VertexStream& position = geometry.position;
+    glVertexAttribPointer(0, position.size, position.type, position.normalized, position.stride, (void*)toBuffer(position.offset));
+    glEnableVertexAttribArray(0);
+    const VertexStream& color = geometry.color;
+    if (color.size > 0) {
+        glVertexAttribPointer(1, color.size, color.type, color.normalized, color.stride, (void*)toBuffer(color.offset));
+        glEnableVertexAttribArray(1);
+    } else {
+        // Disabled arrays read the current attribute value, which is global state
+        glDisableVertexAttribArray(1);
+        glVertexAttrib3f(1, 1.0f, 1.0f, 1.0f);
+    }
+
+    createInstanceBuffer();
+    glBindVertexArray(0);
+
+    setInstances({ Instance() });
+}
+
+void Mesh::init(const PreparedMesh& prepared) {
+    vertexFormat = prepared.vertexFormat;
+    indexType = prepared.indexType;
+    bounds = prepared.bounds;
+    quantization = prepared.quantization;
+    quantizationError = prepared.quantizationError;
+    lods.assign(prepared.lods, prepared.lods + prepared.lodCount);
+    meshlets.assign(prepared.meshlets, prepared.meshlets + prepared.meshletCount);
+    currentLod = 0;
+
+    const Vertex* source = vertexFormat == VertexFormat::Quantized ? prepared.sourceVertices
+                                                                   : static_cast<const Vertex*>(prepared.vertexData);
+    vertices.assign(source, source + prepared.vertexCount);
+    const MeshLod& base = lods[0];
+    if (indexType == GL_UNSIGNED_SHORT) {
+        const GLushort* shortIndices = static_cast<const GLushort*>(prepared.indexData) + base.firstIndex;
+        indices.assign(shortIndices, shortIndices + base.indexCount);
+    } else {
+        const GLuint* intIndices = static_cast<const GLuint*>(prepared.indexData) + base.firstIndex;
+        indices.assign(intIndices, intIndices + base.indexCount);
+    }
+
+    size_t vertexSize = vertexFormat == VertexFormat::Quantized ? sizeof(PackedVertex) : sizeof(Vertex);
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, prepared.vertexCount * vertexSize, prepared.vertexData, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, prepared.indexCount * indexSize, prepared.indexData, GL_STATIC_DRAW);
+
+    setVertexSource(VBO, 0, vertexFormat);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    createInstanceBuffer();
+    glBindVertexArray(0);
+
+    setInstances({ Instance() });
+}
+
+bool Mesh::snapshot(PreparedMesh& prepared, std::vector<char>& vertexStream, std::vector<char>& indexStream) const {
+    if (vertices.empty() || !EBO)
+        return false;
+
+    size_t vertexSize = vertexFormat == VertexFormat::Quantized ? sizeof(PackedVertex) : sizeof(Vertex);
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    const MeshLod& coarsest = lods.back();
+    size_t indexCount = coarsest.firstIndex + coarsest.indexCount;
+
+    // The element buffer binding is VAO state, so read both through the array binding
+    vertexStream.resize(vertices.size() * vertexSize);
+    indexStream.resize(indexCount * indexSize);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, vertexStream.size(), vertexStream.data());
+    glBindBuffer(GL_ARRAY_BUFFER, EBO);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, indexStream.size(), indexStream.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    prepared = PreparedMesh();
+    prepared.vertexFormat = vertexFormat;
+    prepared.indexType = indexType;
+    prepared.vertexData = vertexStream.data();
+    prepared.vertexCount = vertices.size();
+    prepared.indexData = indexStream.data();
+    prepared.indexCount = indexCount;
+    prepared.sourceVertices = vertexFormat == VertexFormat::Quantized ? vertices.data() : nullptr;
+    prepared.lods = lods.data();
+    prepared.lodCount = lods.size();
+    prepared.meshlets = meshlets.data();
+    prepared.meshletCount = meshlets.size();
+    prepared.bounds = bounds;
+    prepared.quantization = quantization;
+    prepared.quantizationError = quantizationError;
+    return true;
+}
+
+// Per-instance model matrix (one vec4 column per location) and color. Expects the VAO bound.
+void Mesh::createInstanceBuffer() {
+    glGenBuffers(1, &instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (GLuint column = 0; column < 4; ++column) {
+        GLuint location = kInstanceModelLocation + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)(offsetof(Instance, model) + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    glVertexAttribPointer(kInstanceColorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, color));
+    glEnableVertexAttribArray(kInstanceColorLocation);
+    glVertexAttribDivisor(kInstanceColorLocation, 1);
+    instanceDivisor = 1;
+}
+
+void Mesh::optimizeGeometry() {
+    if (vertices.empty() || indices.empty())
+        return;
+
+    VertexCacheStats before = analyzeVertexCache(indices, vertices.size());
+
+    std::vector<uint32_t> clusterStarts;
+    optimizeVertexCache(indices, vertices.size(), &clusterStarts);
+    optimizeOverdraw(indices, &vertices[0].position, sizeof(Vertex), vertices.size(), clusterStarts);
+    remapVertices(vertices, optimizeVertexFetch(indices, vertices.size()));
+
+    VertexCacheStats after = analyzeVertexCache(indices, vertices.size());
+    std::cout << "Optimized " << indices.size() / 3 << " triangles, ACMR " << before.acmr << " -> " << after.acmr
+              << ", ATVR " << before.atvr << " -> " << after.atvr << "\n";
+}
+
+// Each level halves the previous one, so clusters and locked borders move between levels.
+// Returns every level's indices back to back, LOD 0 first.
+std::vector<GLuint> Mesh::buildLods(const MeshOptions& options) {
+    constexpr size_t kMinLodTriangles = 64;
+
+    lods.assign(1, MeshLod{ 0, static_cast<GLsizei>(indices.size()), 0.0f });
+    currentLod = 0;
+    std::vector<GLuint> lodIndices = indices;
+    if (!options.generateLods || vertices.empty())
+        return lodIndices;
+
+    std::vector<GLuint> previous = indices, simplified;
+    float error = 0.0f;
+    while (lods.size() < kMaxLods && previous.size() / 3 >= kMinLodTriangles) {
+        float levelError = simplifyMesh(previous, &vertices[0].position, sizeof(Vertex), vertices.size(), previous.size() / 2,
+                                        std::numeric_limits<float>::max(), simplified);
+        // Locked borders and flip checks eventually stall the collapses, a near copy is not worth keeping
+        if (simplified.empty() || simplified.size() > previous.size() * 3 / 4)
+            break;
+        if (options.optimize)
+            optimizeVertexCache(simplified, vertices.size());
+
+        // Levels are simplified from each other, so their errors add up
+        error += levelError;
+        lods.push_back(MeshLod{ static_cast<GLuint>(lodIndices.size()), static_cast<GLsizei>(simplified.size()), error });
+        lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+        previous.swap(simplified);
+    }
+
+    std::cout << "Generated " << lods.size() - 1 << " LODs:";
+    for (const MeshLod& lod : lods)
+        std::cout << " " << lod.indexCount / 3;
+    std::cout << " triangles, coarsest error " << lods.back().error << "\n";
+    return lodIndices;
+}
+
+std::vector<PackedVertex> Mesh::quantizeVertices() {
+    quantization = PositionQuantization::fromBounds(bounds);
+    quantizationError = QuantizationError();
+
+    std::vector<PackedVertex> packed;
+    packed.reserve(vertices.size());
+    for (const Vertex& vertex : vertices) {
+        PackedVertex p = packVertex(vertex.position, vertex.color, quantization);
+        packed.push_back(p);
+
+        quantizationError.maxPosition = std::max(quantizationError.maxPosition, glm::length(unpackPosition(p, quantization) - vertex.position));
+        for (int c = 0; c < 3; ++c)
+            quantizationError.maxColor = std::max(quantizationError.maxColor, std::abs(p.color[c] / 255.0f - vertex.color[c]));
+    }
+
+    float diagonal = bounds.isEmpty() ? 0.0f : glm::length(bounds.max - bounds.min);
+    quantizationError.maxPositionRelative = diagonal > 0.0f ? quantizationError.maxPosition / diagonal : 0.0f;
+
+    std::cout << "Quantized " << vertices.size() << " vertices (" << sizeof(Vertex) << " -> " << sizeof(PackedVertex)
+              << " bytes each), max position error " << quantizationError.maxPosition
+              << " (" << 100.0f * quantizationError.maxPositionRelative << "% of the diagonal), max color error "
+              << quantizationError.maxColor << "\n";
+    return packed;
+}
+
+// Expects the VAO bound
+void Mesh::setVertexSource(GLuint buffer, GLintptr offset, VertexFormat format) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (format == VertexFormat::Quantized) {
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)(offset + offsetof(PackedVertex, position)));
+        glVertexAttribPointer(1, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)(offset + offsetof(PackedVertex, color)));
+    } else {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offset + offsetof(Vertex, position)));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offset + offsetof(Vertex, color)));
+    }
+}
+
+bool Mesh::streamVertices(StreamBuffer& stream, const std::vector<Vertex>& data) {
+    // Instance matrices carry the dequantization, which float vertices must not get
+    if (data.empty() || data.size() != vertices.size() || vertexFormat == VertexFormat::Quantized)
+        return false;
+
+    StreamAllocation allocation = stream.allocate(data.size() * sizeof(Vertex), sizeof(Vertex));
+    if (!allocation.isValid())
+        return false;
+    std::memcpy(allocation.data, data.data(), data.size() * sizeof(Vertex));
+
+    glBindVertexArray(VAO);
+    setVertexSource(stream.getBuffer(), allocation.offset, VertexFormat::Float);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void Mesh::useStaticVertices() {
+    // External geometry has its own layout and is never streamed over
+    if (vertices.empty())
+        return;
+    glBindVertexArray(VAO);
+    setVertexSource(VBO, 0, vertexFormat);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Mesh::setInstances(const std::vector<Instance>& data) {
+    instances = data;
+    dirtyFirst = dirtyLast = 0;
+    instanceBoundsDirty = true;
+
+    // Reallocating orphans the old storage, in-flight draws keep reading it
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance), nullptr, GL_DYNAMIC_DRAW);
+    uploadInstances(0, instances.size());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Expects instanceVBO bound. Quantized meshes get the snorm decode folded into each uploaded
+// matrix, so shaders see ordinary mesh-space positions at no extra per-vertex cost.
+void Mesh::uploadInstances(size_t first, size_t last) const {
+    if (first == last)
+        return;
+
+    const Instance* source = instances.data() + first;
+    std::vector<Instance> decoded;
+    if (vertexFormat == VertexFormat::Quantized) {
+        glm::mat4 decode = quantization.decodeMatrix();
+        decoded.assign(source, source + (last - first));
+        for (Instance& instance : decoded)
+            instance.model = instance.model * decode;
+        source = decoded.data();
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(Instance), (last - first) * sizeof(Instance), source);
+}
+
+void Mesh::setInstance(size_t index, const Instance& instance) {
+    updateInstances(index, &instance, 1);
+}
+
+void Mesh::updateInstances(size_t first, const Instance* data, size_t count) {
+    if (first >= instances.size())
+        return;
+    count = std::min(count, instances.size() - first);
+    std::copy(data, data + count, instances.begin() + first);
+    markDirty(first, first + count);
+}
+
+void Mesh::markDirty(size_t first, size_t last) {
+    if (dirtyFirst == dirtyLast) {
+        dirtyFirst = first;
+        dirtyLast = last;
+    } else {
+        dirtyFirst = std::min(dirtyFirst, first);
+        dirtyLast = std::max(dirtyLast, last);
+    }
+    instanceBoundsDirty = true;
+}
+
+const BoundingBox& Mesh::getInstanceBounds() const {
+    if (instanceBoundsDirty) {
+        instanceBounds = BoundingBox();
+        for (const Instance& instance : instances)
+            expandBounds(instanceBounds, transformBounds(bounds, instance.model));
+        instanceBoundsDirty = false;
+    }
+    return instanceBounds;
+}
+
+void Mesh::prepareDraw(GLuint divisor) const {
+    glBindVertexArray(VAO);
+
+    if (dirtyFirst != dirtyLast) {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        uploadInstances(dirtyFirst, dirtyLast);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        dirtyFirst = dirtyLast = 0;
+    }
+
+    // The divisor is VAO state, only touch it when the repeat count changes
+    if (divisor != instanceDivisor) {
+        for (GLuint location = kInstanceModelLocation; location <= kInstanceColorLocation; ++location)
+            glVertexAttribDivisor(location, divisor);
+        instanceDivisor = divisor;
+    }
+}
+
+size_t Mesh::selectLod(double pixelsPerUnit, double maxPixelError) const {
+    size_t level = 0;
+    while (level + 1 < lods.size() && lods[level + 1].error * pixelsPerUnit <= maxPixelError)
+        ++level;
+    return level;
+}
+
+void Mesh::setLod(size_t level) {
+    currentLod = std::min(level, lods.size() - 1);
+}
+
+void Mesh::draw() const {
+    drawInstanced(1);
+}
+
+void Mesh::drawInstanced(GLsizei repeat) const {
+    const MeshLod& lod = lods[currentLod];
+    size_t indexSize = indexType == GL_UNSIGNED_BYTE ? sizeof(GLubyte) : indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    prepareDraw(static_cast<GLuint>(repeat));
+    glDrawElementsInstanced(GL_TRIANGLES, lod.indexCount, indexType, (void*)(lod.firstIndex * indexSize),
+                            static_cast<GLsizei>(instances.size()) * repeat);
     glBindVertexArray(0);
 }
 
@@ -61,4 +481,6 @@ void Mesh::cleanup() {
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
+    glDeleteBuffers(1, &instanceVBO);
+    VAO = VBO = EBO = instanceVBO = 0;
 }
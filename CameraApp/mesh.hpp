@@ -11,24 +11,196 @@
 #pragma once
 
 #include <GL/glew.h>
+#include <cstddef>
 #include <vector>
 #include <glm/glm.hpp>
 
+#include "bounds.hpp"
+#include "vertex_quantization.hpp"
+#include "meshlets.hpp"
+
+class StreamBuffer;
+
 struct Vertex {
     glm::vec3 position;
     glm::vec3 color;
 };
 
+// Per-instance attributes: model at locations 2-5, color at 6. The model matrix is relative
+// to the transform given to the camera for the whole mesh.
+struct Instance {
+    glm::mat4 model = glm::mat4(1.0f);
+    glm::vec4 color = glm::vec4(1.0f);
+};
+
+enum class VertexFormat {
+    Float,      // Vertex, 24 bytes
+    Quantized   // PackedVertex, 12 bytes: snorm16 position in the AABB, RGBA8 color
+};
+
+struct MeshOptions {
+    VertexFormat vertexFormat = VertexFormat::Float;
+    // Reorder triangles for the vertex cache and overdraw, then vertices for fetch, before upload
+    bool optimize = false;
+    // Append simplified index ranges (quadric edge collapse) sharing the same vertices
+    bool generateLods = false;
+    // Regroup LOD 0 into meshlets with bounding spheres and normal cones for per-frame culling
+    bool meshlets = false;
+};
+
+// One level of detail: a range of the mesh's index buffer
+struct MeshLod {
+    GLuint firstIndex = 0;
+    GLsizei indexCount = 0;
+    float error = 0.0f;   // estimated deviation from LOD 0, in mesh units
+};
+
+// One vertex attribute inside an ExternalGeometry block
+struct VertexStream {
+    GLint size = 0;            // components, 0 when the attribute is absent
+    GLenum type = GL_FLOAT;
+    GLboolean normalized = GL_FALSE;
+    GLsizei stride = 0;
+    GLintptr offset = 0;       // bytes from ExternalGeometry::data
+};
+
+// A byte range of ExternalGeometry::data that reaches the GPU
+struct ExternalSpan {
+    size_t offset = 0;         // 4-aligned
+    size_t size = 0;
+};
+
+// Geometry already in a GPU-ready layout (e.g. glTF accessors in a mapped file): only the spans
+// the streams read are copied, back to back, into one buffer that serves both vertices and
+// indices. Every offset below addresses data and must fall inside a span.
+struct ExternalGeometry {
+    static constexpr size_t kMaxSpans = 3;
+
+    const char* data = nullptr;
+    ExternalSpan spans[kMaxSpans];   // disjoint
+    size_t spanCount = 0;
+    VertexStream position;     // 3 floats
+    VertexStream color;        // white when absent
+    GLenum indexType = GL_UNSIGNED_INT;
+    GLintptr indexOffset = 0;  // bytes, a multiple of the index size
+    GLsizei indexCount = 0;
+    GLsizei vertexCount = 0;
+    BoundingBox bounds;
+
+    size_t getUploadSize() const {
+        size_t total = 0;
+        for (size_t i = 0; i < spanCount; ++i)
+            total += (spans[i].size + 3) & ~size_t(3);
+        return total;
+    }
+};
+
+// Everything upload() hands to GL and derives on the way, e.g. as stored by the mesh cache.
+// The streams are in their GPU layout; pointers only need to live through init.
+struct PreparedMesh {
+    VertexFormat vertexFormat = VertexFormat::Float;
+    GLenum indexType = GL_UNSIGNED_INT;
+    const void* vertexData = nullptr;        // Vertex or PackedVertex, per vertexFormat
+    size_t vertexCount = 0;
+    const void* indexData = nullptr;         // every LOD back to back, of indexType
+    size_t indexCount = 0;
+    const Vertex* sourceVertices = nullptr;  // float originals of quantized meshes, null otherwise
+    const MeshLod* lods = nullptr;
+    size_t lodCount = 0;
+    const Meshlet* meshlets = nullptr;
+    size_t meshletCount = 0;
+    BoundingBox bounds;
+    PositionQuantization quantization;
+    QuantizationError quantizationError;
+};
+
 class Mesh {
 public:
-    void init();
+    static constexpr GLuint kInstanceModelLocation = 2;
+    static constexpr GLuint kInstanceColorLocation = 6;
+    static constexpr size_t kMaxLods = 8;
+
+    // Builds the colored cube
+    void init(const MeshOptions& options = MeshOptions());
+    // Takes over imported geometry, e.g. from loadObj
+    void init(std::vector<Vertex> vertices, std::vector<GLuint> indices, const MeshOptions& options = MeshOptions());
+    // GPU-only mesh without a CPU copy: getVertices()/getIndices() stay empty, so picking, the
+    // arena, streaming and the load-time options (optimize, LODs, meshlets, quantize) skip it
+    void init(const ExternalGeometry& geometry);
+    // Skips every load-time step: one glBufferData per stream, plus the CPU copies of the
+    // vertices and LOD 0 indices that picking and the arena read
+    void init(const PreparedMesh& prepared);
+    // The inverse, with the streams read back from the GPU into the given storage; false for
+    // external geometry, which has no CPU copy
+    bool snapshot(PreparedMesh& prepared, std::vector<char>& vertexStream, std::vector<char>& indexStream) const;
+    // Draws every instance in one call, at the current LOD
     void draw() const;
+    // Draws every instance `repeat` times in a row, gl_InstanceID % repeat tells the copies apart
+    void drawInstanced(GLsizei repeat) const;
     void cleanup();
 
+    // Replaces all instances (a mesh starts with one identity instance)
+    void setInstances(const std::vector<Instance>& data);
+    // Incremental updates, coalesced into one upload of the dirty range at the next draw
+    void setInstance(size_t index, const Instance& instance);
+    void updateInstances(size_t first, const Instance* data, size_t count);
+    size_t getInstanceCount() const { return instances.size(); }
+    const std::vector<Instance>& getInstances() const { return instances; }
+
+    // Draws use these vertices (same count as the static ones, e.g. deformed) until the next
+    // call or useStaticVertices(); flush the stream before drawing
+    bool streamVertices(StreamBuffer& stream, const std::vector<Vertex>& data);
+    void useStaticVertices();
+
+    // Coarsest LOD whose error stays within maxPixelError on screen, given the pixels covered
+    // by one mesh unit (see Camera::getPixelsPerUnit)
+    size_t selectLod(double pixelsPerUnit, double maxPixelError) const;
+    void setLod(size_t level);
+    size_t getLod() const { return currentLod; }
+    // LOD 0 is the full index list, coarser levels follow it in the same element buffer
+    const std::vector<MeshLod>& getLods() const { return lods; }
+    // Empty unless built at init; ranges of getIndices()
+    const std::vector<Meshlet>& getMeshlets() const { return meshlets; }
+
+    const BoundingBox& getBounds() const { return bounds; }
+    // Union of the bounds of every instance, recomputed lazily after instance changes
+    const BoundingBox& getInstanceBounds() const;
+    const std::vector<Vertex>& getVertices() const { return vertices; }
+    const std::vector<GLuint>& getIndices() const { return indices; }
+    VertexFormat getVertexFormat() const { return vertexFormat; }
+    // GL_UNSIGNED_SHORT whenever the vertex count allows it; external geometry keeps its own
+    GLenum getIndexType() const { return indexType; }
+    const QuantizationError& getQuantizationError() const { return quantizationError; }
+    const PositionQuantization& getQuantization() const { return quantization; }
+
 private:
-    GLuint VAO = 0, VBO = 0, EBO = 0;
+    GLuint VAO = 0, VBO = 0, EBO = 0, instanceVBO = 0;
     std::vector<Vertex> vertices;
     std::vector<GLuint> indices;
+    BoundingBox bounds;
+    VertexFormat vertexFormat = VertexFormat::Float;
+    GLenum indexType = GL_UNSIGNED_INT;
+    PositionQuantization quantization;
+    QuantizationError quantizationError;
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+    size_t currentLod = 0;
+
+    std::vector<Instance> instances;
+    mutable size_t dirtyFirst = 0, dirtyLast = 0;   // [first, last) not yet uploaded
+    mutable GLuint instanceDivisor = 1;
+    mutable BoundingBox instanceBounds;
+    mutable bool instanceBoundsDirty = true;
+
+    void upload(const MeshOptions& options);
+    void createInstanceBuffer();
+    void optimizeGeometry();
+    std::vector<GLuint> buildLods(const MeshOptions& options);
+    std::vector<PackedVertex> quantizeVertices();
+    void markDirty(size_t first, size_t last);
+    void setVertexSource(GLuint buffer, GLintptr offset, VertexFormat format);
+    void uploadInstances(size_t first, size_t last) const;
+    void prepareDraw(GLuint divisor) const;
 };
 
 #endif /* mesh_hpp */
@@ -0,0 +1,293 @@
+//
+//  mesh_cache.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/22/25.
+//
+
+#include "mesh_cache.hpp"
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = { 'C', 'A', 'M', 'M', 'E', 'S', 'H', '\0' };
+// Every stream starts on its own page of the mapping
+constexpr uint64_t kSectionAlignment = 4096;
+constexpr size_t kHashChunkBytes = size_t(8) << 20;
+
+enum Section { kVertexSection, kIndexSection, kLodSection, kMeshletSection, kSourceVertexSection, kSectionCount };
+
+enum OptionFlags : uint32_t {
+    kOptimized = 1u << 0,
+    kWithLods = 1u << 1,
+    kWithMeshlets = 1u << 2,
+};
+
+struct SectionRange {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+// Stored as is, little-endian like every host we build for
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t fileSize;
+    uint64_t sourceHash;
+    uint32_t optionFlags;
+    uint32_t vertexFormat;
+    uint32_t indexType;
+    // Sizes of the stored structs, a second guard next to the version
+    uint32_t vertexSize, sourceVertexSize, lodSize, meshletSize;
+    uint32_t reserved;
+    uint64_t vertexCount, indexCount, lodCount, meshletCount;
+    BoundingBox bounds;
+    PositionQuantization quantization;
+    QuantizationError quantizationError;
+    SectionRange sections[kSectionCount];
+};
+
+static_assert(std::is_trivially_copyable<Header>::value, "the header is written with one memcpy");
+static_assert(std::is_trivially_copyable<MeshLod>::value && std::is_trivially_copyable<Meshlet>::value,
+              "cached tables are written as raw bytes");
+
+uint64_t alignSection(uint64_t offset) {
+    return (offset + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+}
+
+uint32_t optionFlags(const MeshOptions& options) {
+    return (options.optimize ? kOptimized : 0u) | (options.generateLods ? kWithLods : 0u) | (options.meshlets ? kWithMeshlets : 0u);
+}
+
+// FNV-1a over 8-byte words, finished with the murmur3 mixer so every input bit reaches every output bit
+constexpr uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+constexpr uint64_t kFnvPrime = 0x100000001b3ull;
+
+uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t hashBytes(const char* data, size_t size) {
+    uint64_t hash = kFnvOffset;
+    size_t words = size / 8;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t word;
+        std::memcpy(&word, data + i * 8, sizeof(word));
+        hash = (hash ^ word) * kFnvPrime;
+    }
+    for (size_t i = words * 8; i < size; ++i)
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * kFnvPrime;
+    return mix(hash);
+}
+
+template <typename Index>
+bool indicesInRange(const void* data, size_t count, size_t vertexCount) {
+    const Index* indices = static_cast<const Index*>(data);
+    std::atomic<bool> valid(true);
+    parallelFor(count, 1 << 20, [&](size_t begin, size_t end) {
+        Index highest = 0;
+        for (size_t i = begin; i < end; ++i)
+            highest = std::max(highest, indices[i]);
+        if (static_cast<size_t>(highest) >= vertexCount)
+            valid.store(false);
+    });
+    return valid.load();
+}
+
+}
+
+bool hashFile(const std::string& path, uint64_t& hash) {
+    MappedFile file;
+    if (!file.open(path, MappedFile::Access::Sequential))
+        return false;
+
+    // Fixed chunk size, so the result does not depend on the worker count
+    size_t chunks = (file.size() + kHashChunkBytes - 1) / kHashChunkBytes;
+    std::vector<uint64_t> chunkHashes(chunks);
+    parallelFor(chunks, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            size_t offset = c * kHashChunkBytes;
+            chunkHashes[c] = hashBytes(file.data() + offset, std::min(kHashChunkBytes, file.size() - offset));
+        }
+    });
+
+    hash = kFnvOffset;
+    for (uint64_t chunkHash : chunkHashes)
+        hash = (hash ^ chunkHash) * kFnvPrime;
+    hash = mix(hash ^ file.size());
+    return true;
+}
+
+bool writeMeshCache(const std::string& path, const Mesh& mesh, const MeshOptions& options, uint64_t sourceHash) {
+    PreparedMesh prepared;
+    std::vector<char> vertexStream, indexStream;
+    if (!mesh.snapshot(prepared, vertexStream, indexStream)) {
+        std::cerr << "Cannot cache a mesh without a CPU copy\n";
+        return false;
+    }
+
+    Header header;
+    std::memset(static_cast<void*>(&header), 0, sizeof(header));   // padding bytes too, so caches are reproducible
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kMeshCacheVersion;
+    header.headerSize = sizeof(Header);
+    header.sourceHash = sourceHash;
+    header.optionFlags = optionFlags(options);
+    header.vertexFormat = static_cast<uint32_t>(prepared.vertexFormat);
+    header.indexType = prepared.indexType;
+    header.vertexSize = static_cast<uint32_t>(prepared.vertexFormat == VertexFormat::Quantized ? sizeof(PackedVertex) : sizeof(Vertex));
+    header.sourceVertexSize = sizeof(Vertex);
+    header.lodSize = sizeof(MeshLod);
+    header.meshletSize = sizeof(Meshlet);
+    header.vertexCount = prepared.vertexCount;
+    header.indexCount = prepared.indexCount;
+    header.lodCount = prepared.lodCount;
+    header.meshletCount = prepared.meshletCount;
+    header.bounds = prepared.bounds;
+    header.quantization = prepared.quantization;
+    header.quantizationError = prepared.quantizationError;
+
+    const void* sectionData[kSectionCount] = { vertexStream.data(), indexStream.data(), prepared.lods, prepared.meshlets, prepared.sourceVertices };
+    uint64_t sectionSizes[kSectionCount] = {
+        vertexStream.size(), indexStream.size(), prepared.lodCount * sizeof(MeshLod), prepared.meshletCount * sizeof(Meshlet),
+        prepared.sourceVertices ? prepared.vertexCount * sizeof(Vertex) : 0,
+    };
+    uint64_t offset = alignSection(sizeof(Header));
+    for (int s = 0; s < kSectionCount; ++s) {
+        header.sections[s] = { sectionSizes[s] ? offset : 0, sectionSizes[s] };
+        offset = alignSection(offset + sectionSizes[s]);
+    }
+    header.fileSize = offset;
+
+    std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to write mesh cache " << temporary << "\n";
+        return false;
+    }
+
+    static const char kPadding[kSectionAlignment] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    for (int s = 0; s < kSectionCount; ++s) {
+        if (sectionSizes[s] == 0)
+            continue;
+        out.write(kPadding, static_cast<std::streamsize>(header.sections[s].offset - written));
+        out.write(static_cast<const char*>(sectionData[s]), static_cast<std::streamsize>(sectionSizes[s]));
+        written = header.sections[s].offset + sectionSizes[s];
+    }
+    out.write(kPadding, static_cast<std::streamsize>(header.fileSize - written));
+    out.close();
+
+    if (!out || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write mesh cache " << path << "\n";
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool loadMeshCache(const std::string& path, const MeshOptions& options, uint64_t sourceHash, Mesh& mesh) {
+    // No cache yet is the normal first run, not worth a message
+    if (access(path.c_str(), R_OK) != 0)
+        return false;
+
+    MappedFile file;
+    if (!file.open(path, MappedFile::Access::Sequential))
+        return false;
+
+    auto corrupt = [&path](const char* reason) {
+        std::cerr << "Ignoring mesh cache " << path << ": " << reason << "\n";
+        return false;
+    };
+
+    Header header;
+    if (file.size() < sizeof(Header))
+        return corrupt("truncated header");
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+        return corrupt("not a mesh cache");
+
+    // Stale: another version, source or set of load-time options, rebuilt without complaint
+    bool quantized = header.vertexFormat == static_cast<uint32_t>(VertexFormat::Quantized);
+    if (header.version != kMeshCacheVersion || header.sourceHash != sourceHash || header.optionFlags != optionFlags(options)
+        || quantized != (options.vertexFormat == VertexFormat::Quantized))
+        return false;
+
+    size_t vertexSize = quantized ? sizeof(PackedVertex) : sizeof(Vertex);
+    size_t indexSize = header.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    if (header.fileSize != file.size())
+        return corrupt("truncated");
+    if (header.headerSize != sizeof(Header) || header.vertexSize != vertexSize
+        || header.sourceVertexSize != sizeof(Vertex) || header.lodSize != sizeof(MeshLod) || header.meshletSize != sizeof(Meshlet))
+        return corrupt("layout mismatch");
+    if (header.indexType != GL_UNSIGNED_SHORT && header.indexType != GL_UNSIGNED_INT)
+        return corrupt("unknown index type");
+    if (header.lodCount == 0 || header.lodCount > Mesh::kMaxLods || header.vertexCount == 0)
+        return corrupt("bad counts");
+
+    uint64_t expectedSizes[kSectionCount] = {
+        header.vertexCount * vertexSize, header.indexCount * indexSize, header.lodCount * sizeof(MeshLod),
+        header.meshletCount * sizeof(Meshlet), quantized ? header.vertexCount * sizeof(Vertex) : 0,
+    };
+    const char* sections[kSectionCount] = {};
+    for (int s = 0; s < kSectionCount; ++s) {
+        const SectionRange& range = header.sections[s];
+        if (range.size != expectedSizes[s] || range.offset % kSectionAlignment != 0 || range.offset > file.size()
+            || range.size > file.size() - range.offset)
+            return corrupt("section out of range");
+        sections[s] = range.size ? file.data() + range.offset : nullptr;
+    }
+
+    // Everything below indexes with these ranges, so a bad file must not get past here
+    const MeshLod* lods = reinterpret_cast<const MeshLod*>(sections[kLodSection]);
+    for (size_t i = 0; i < header.lodCount; ++i) {
+        if (lods[i].indexCount < 0 || lods[i].firstIndex + static_cast<uint64_t>(lods[i].indexCount) > header.indexCount)
+            return corrupt("LOD outside the index stream");
+    }
+    const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(sections[kMeshletSection]);
+    for (size_t i = 0; i < header.meshletCount; ++i) {
+        if (meshlets[i].firstIndex + 3ull * meshlets[i].triangleCount > static_cast<uint64_t>(lods[0].indexCount))
+            return corrupt("meshlet outside LOD 0");
+    }
+    bool inRange = header.indexType == GL_UNSIGNED_SHORT
+                 ? indicesInRange<GLushort>(sections[kIndexSection], header.indexCount, header.vertexCount)
+                 : indicesInRange<GLuint>(sections[kIndexSection], header.indexCount, header.vertexCount);
+    if (!inRange)
+        return corrupt("index past the last vertex");
+
+    PreparedMesh prepared;
+    prepared.vertexFormat = quantized ? VertexFormat::Quantized : VertexFormat::Float;
+    prepared.indexType = header.indexType;
+    prepared.vertexData = sections[kVertexSection];
+    prepared.vertexCount = header.vertexCount;
+    prepared.indexData = sections[kIndexSection];
+    prepared.indexCount = header.indexCount;
+    prepared.sourceVertices = reinterpret_cast<const Vertex*>(sections[kSourceVertexSection]);
+    prepared.lods = lods;
+    prepared.lodCount = header.lodCount;
+    prepared.meshlets = meshlets;
+    prepared.meshletCount = header.meshletCount;
+    prepared.bounds = header.bounds;
+    prepared.quantization = header.quantization;
+    prepared.quantizationError = header.quantizationError;
+    mesh.init(prepared);
+    return true;
+}
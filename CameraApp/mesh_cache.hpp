@@ -0,0 +1,37 @@
+//
+//  mesh_cache.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/22/25.
+//
+
+#ifndef mesh_cache_hpp
+#define mesh_cache_hpp
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "mesh.hpp"
+
+// Bump whenever the file layout or any stored struct (Vertex, PackedVertex, MeshLod, Meshlet) changes
+constexpr uint32_t kMeshCacheVersion = 1;
+
+// 64-bit content hash of a whole file, hashed in parallel chunks of the mapping. False when the
+// file cannot be read.
+bool hashFile(const std::string& path, uint64_t& hash);
+
+// Native mesh cache: a header followed by page-aligned sections holding the vertex and index
+// streams exactly as uploaded, the LOD table, the meshlets and, for quantized meshes, the float
+// vertices. Loading maps the file and hands each stream to one glBufferData.
+//
+// Writes through a temporary file and a rename, so readers never see half a cache. Reports
+// errors on std::cerr; a mesh without a CPU copy (external geometry) cannot be cached.
+bool writeMeshCache(const std::string& path, const Mesh& mesh, const MeshOptions& options, uint64_t sourceHash);
+
+// Initializes mesh from the cache when it was built from a source with sourceHash using the same
+// options. A missing or stale cache returns false quietly, a corrupt one with a warning.
+bool loadMeshCache(const std::string& path, const MeshOptions& options, uint64_t sourceHash, Mesh& mesh);
+
+#endif /* mesh_cache_hpp */
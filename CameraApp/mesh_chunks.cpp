@@ -0,0 +1,193 @@
+//
+//  mesh_chunks.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/26/25.
+//
+
+#include "mesh_chunks.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+constexpr char kMagic[8] = { 'C', 'A', 'M', 'C', 'H', 'N', 'K', '\0' };
+
+// Stored as is, little-endian like every host we build for
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t recordSize;
+    uint32_t vertexSize;
+    uint64_t chunkCount;
+    uint64_t tableOffset;
+    uint64_t triangleCount;
+    BoundingBox bounds;
+    uint32_t reserved;
+};
+
+static_assert(std::is_trivially_copyable<Header>::value && std::is_trivially_copyable<ChunkRecord>::value,
+              "the header and table are written as raw bytes");
+
+uint64_t alignChunk(uint64_t offset) {
+    return (offset + kChunkAlignment - 1) & ~(kChunkAlignment - 1);
+}
+
+}
+
+bool writeChunkFile(const std::string& path, const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices,
+                    size_t maxTriangles) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        std::cerr << "Nothing to chunk\n";
+        return false;
+    }
+    maxTriangles = std::max<size_t>(maxTriangles, 1);
+
+    std::vector<glm::vec3> centroids(triangleCount);
+    parallelFor(triangleCount, 1 << 16, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            centroids[t] = (vertices[indices[3 * t]].position + vertices[indices[3 * t + 1]].position
+                            + vertices[indices[3 * t + 2]].position) / 3.0f;
+        }
+    });
+
+    // Depth-first median splits; leaves come out left to right, so file order follows space
+    std::vector<uint32_t> order(triangleCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::vector<std::pair<size_t, size_t>> leaves, pending = { { 0, triangleCount } };
+    while (!pending.empty()) {
+        std::pair<size_t, size_t> range = pending.back();
+        pending.pop_back();
+        if (range.second - range.first <= maxTriangles) {
+            leaves.push_back(range);
+            continue;
+        }
+
+        BoundingBox box;
+        for (size_t i = range.first; i < range.second; ++i)
+            expandBounds(box, centroids[order[i]]);
+        glm::vec3 size = box.max - box.min;
+        int axis = size.x >= size.y && size.x >= size.z ? 0 : size.y >= size.z ? 1 : 2;
+        size_t middle = range.first + (range.second - range.first) / 2;
+        std::nth_element(order.begin() + range.first, order.begin() + middle, order.begin() + range.second,
+                         [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        pending.push_back({ middle, range.second });
+        pending.push_back({ range.first, middle });
+    }
+
+    std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to write chunk file " << temporary << "\n";
+        return false;
+    }
+
+    Header header;
+    std::memset(static_cast<void*>(&header), 0, sizeof(header));   // padding bytes too, so files are reproducible
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kChunkFileVersion;
+    header.headerSize = sizeof(Header);
+    header.recordSize = sizeof(ChunkRecord);
+    header.vertexSize = sizeof(Vertex);
+    header.chunkCount = leaves.size();
+    header.tableOffset = sizeof(Header);
+    header.triangleCount = triangleCount;
+    header.bounds = BoundingBox();
+
+    // The table is rewritten once every chunk's offset and bounds are known
+    std::vector<ChunkRecord> records(leaves.size());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(ChunkRecord)));
+
+    static const char kPadding[kChunkAlignment] = {};
+    uint64_t written = sizeof(Header) + records.size() * sizeof(ChunkRecord);
+    std::vector<uint32_t> remap(vertices.size(), std::numeric_limits<uint32_t>::max());
+    std::vector<uint32_t> used;
+    std::vector<Vertex> chunkVertices;
+    std::vector<GLuint> chunkIndices;
+    for (size_t c = 0; c < leaves.size(); ++c) {
+        chunkVertices.clear();
+        chunkIndices.clear();
+        used.clear();
+        ChunkRecord& record = records[c];
+        for (size_t i = leaves[c].first; i < leaves[c].second; ++i) {
+            for (int k = 0; k < 3; ++k) {
+                GLuint vertex = indices[3 * order[i] + k];
+                if (remap[vertex] == std::numeric_limits<uint32_t>::max()) {
+                    remap[vertex] = static_cast<uint32_t>(chunkVertices.size());
+                    used.push_back(vertex);
+                    chunkVertices.push_back(vertices[vertex]);
+                    expandBounds(record.bounds, vertices[vertex].position);
+                }
+                chunkIndices.push_back(remap[vertex]);
+            }
+        }
+        for (uint32_t vertex : used)
+            remap[vertex] = std::numeric_limits<uint32_t>::max();
+
+        record.offset = alignChunk(written);
+        record.vertexCount = static_cast<uint32_t>(chunkVertices.size());
+        record.indexCount = static_cast<uint32_t>(chunkIndices.size());
+        expandBounds(header.bounds, record.bounds);
+
+        out.write(kPadding, static_cast<std::streamsize>(record.offset - written));
+        out.write(reinterpret_cast<const char*>(chunkVertices.data()), static_cast<std::streamsize>(chunkVertices.size() * sizeof(Vertex)));
+        out.write(reinterpret_cast<const char*>(chunkIndices.data()), static_cast<std::streamsize>(chunkIndices.size() * sizeof(GLuint)));
+        written = record.offset + record.getSize();
+    }
+    out.write(kPadding, static_cast<std::streamsize>(alignChunk(written) - written));
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(ChunkRecord)));
+    out.close();
+
+    if (!out || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write chunk file " << path << "\n";
+        std::remove(temporary.c_str());
+        return false;
+    }
+    std::cout << "Wrote " << leaves.size() << " chunks of up to " << maxTriangles << " triangles to " << path << "\n";
+    return true;
+}
+
+bool readChunkTable(const MappedFile& file, const std::string& path, std::vector<ChunkRecord>& chunks, BoundingBox& bounds) {
+    auto invalid = [&path](const char* reason) {
+        std::cerr << path << ": " << reason << "\n";
+        return false;
+    };
+
+    Header header;
+    if (file.size() < sizeof(Header))
+        return invalid("not a chunk file");
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+        return invalid("not a chunk file");
+    if (header.version != kChunkFileVersion || header.headerSize != sizeof(Header) || header.recordSize != sizeof(ChunkRecord)
+        || header.vertexSize != sizeof(Vertex))
+        return invalid("written by another version, convert the model again");
+    if (header.chunkCount == 0 || header.tableOffset > file.size()
+        || header.chunkCount > (file.size() - header.tableOffset) / sizeof(ChunkRecord))
+        return invalid("chunk table out of range");
+
+    chunks.resize(header.chunkCount);
+    std::memcpy(chunks.data(), file.data() + header.tableOffset, chunks.size() * sizeof(ChunkRecord));
+    for (const ChunkRecord& chunk : chunks) {
+        if (chunk.offset % kChunkAlignment != 0 || chunk.offset > file.size() || chunk.getSize() > file.size() - chunk.offset
+            || chunk.vertexCount == 0 || chunk.indexCount == 0 || chunk.indexCount % 3 != 0)
+            return invalid("chunk out of range");
+    }
+    bounds = header.bounds;
+    return true;
+}
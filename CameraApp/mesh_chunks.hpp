@@ -0,0 +1,48 @@
+//
+//  mesh_chunks.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/26/25.
+//
+
+#ifndef mesh_chunks_hpp
+#define mesh_chunks_hpp
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+#include "mapped_file.hpp"
+
+// Bump whenever the file layout, Vertex or ChunkRecord changes
+constexpr uint32_t kChunkFileVersion = 1;
+constexpr size_t kChunkTriangles = 32768;
+// Chunk data starts on a page boundary and is padded to one, so it maps and releases cleanly
+constexpr uint64_t kChunkAlignment = 4096;
+
+// One spatial piece of a chunked mesh: its own vertices, then indices local to them
+struct ChunkRecord {
+    BoundingBox bounds;
+    uint64_t offset = 0;        // bytes from the start of the file
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+
+    uint64_t getSize() const { return vertexCount * uint64_t(sizeof(Vertex)) + indexCount * uint64_t(sizeof(GLuint)); }
+};
+
+// Partitions the mesh spatially (median splits along the longest axis of the triangle centroids)
+// into chunks of at most maxTriangles and writes them for ChunkStreamer. Neighbouring chunks end
+// up next to each other in the file. The mesh has to fit in memory once, at conversion time;
+// viewing the result does not. Reports errors on std::cerr.
+bool writeChunkFile(const std::string& path, const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices,
+                    size_t maxTriangles = kChunkTriangles);
+
+// Validates the header and chunk table of a mapped chunk file
+bool readChunkTable(const MappedFile& file, const std::string& path, std::vector<ChunkRecord>& chunks, BoundingBox& bounds);
+
+#endif /* mesh_chunks_hpp */
@@ -0,0 +1,99 @@
+//
+//  meshlet_culling.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/8/25.
+//
+
+#include "meshlet_culling.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+bool sphereOutside(const Frustum& frustum, const glm::vec3& center, float radius) {
+    for (const glm::vec4& plane : frustum.planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return true;
+    }
+    return false;
+}
+
+}
+
+void MeshletCuller::cull(const std::vector<Meshlet>& meshlets, const ArenaMesh& mesh, const std::vector<Instance>& instances,
+                         const std::vector<uint32_t>& instanceIds, const glm::mat4& relativeModel, const Frustum& frustum,
+                         bool coneCulling, DrawList& drawList, MeshletCullStats* stats) {
+    size_t meshletCount = meshlets.size();
+    if (meshletCount == 0 || instanceIds.empty())
+        return;
+
+    transforms.resize(instanceIds.size());
+    for (size_t i = 0; i < instanceIds.size(); ++i) {
+        InstanceTransform& transform = transforms[i];
+        transform.model = relativeModel * instances[instanceIds[i]].model;
+        float scaleX = glm::length(glm::vec3(transform.model[0]));
+        float scaleY = glm::length(glm::vec3(transform.model[1]));
+        float scaleZ = glm::length(glm::vec3(transform.model[2]));
+        transform.maxScale = std::max(scaleX, std::max(scaleY, scaleZ));
+        float minScale = std::min(scaleX, std::min(scaleY, scaleZ));
+        // Mirroring flips the winding, and with it which side of the cone faces away
+        glm::vec3 x(transform.model[0]), y(transform.model[1]), z(transform.model[2]);
+        bool mirrored = glm::dot(glm::cross(x, y), z) < 0.0f;
+        transform.coneValid = coneCulling && !mirrored && minScale > 0.99f * transform.maxScale;
+    }
+
+    // The eye is the origin of camera-relative space
+    results.resize(instanceIds.size() * meshletCount);
+    parallelFor(results.size(), 1024, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const InstanceTransform& transform = transforms[i / meshletCount];
+            const Meshlet& meshlet = meshlets[i % meshletCount];
+
+            glm::vec3 center = glm::vec3(transform.model * glm::vec4(meshlet.center, 1.0f));
+            float radius = meshlet.radius * transform.maxScale;
+            if (sphereOutside(frustum, center, radius)) {
+                results[i] = OutsideFrustum;
+                continue;
+            }
+            if (transform.coneValid) {
+                glm::vec3 axis = glm::normalize(glm::vec3(transform.model * glm::vec4(meshlet.coneAxis, 0.0f)));
+                if (isMeshletBackFacing(center, radius, axis, meshlet.coneCutoff, glm::vec3(0.0f))) {
+                    results[i] = BackFacing;
+                    continue;
+                }
+            }
+            results[i] = Visible;
+        }
+    });
+
+    MeshletCullStats frame;
+    for (size_t i = 0; i < instanceIds.size(); ++i) {
+        const uint8_t* row = &results[i * meshletCount];
+        size_t m = 0;
+        while (m < meshletCount) {
+            if (row[m] != Visible) {
+                frame.frustumCulled += row[m] == OutsideFrustum;
+                frame.coneCulled += row[m] == BackFacing;
+                ++m;
+                continue;
+            }
+
+            size_t first = m;
+            while (m < meshletCount && row[m] == Visible)
+                ++m;
+            const Meshlet& last = meshlets[m - 1];
+            ArenaMesh range = mesh;
+            range.firstIndex = mesh.firstIndex + meshlets[first].firstIndex;
+            range.indexCount = static_cast<GLsizei>(last.firstIndex + last.triangleCount * 3 - meshlets[first].firstIndex);
+            drawList.add(range, instanceIds[i]);
+            frame.visibleTriangles += range.indexCount / 3;
+        }
+    }
+    frame.tested = results.size();
+
+    if (stats)
+        *stats = frame;
+}
@@ -0,0 +1,55 @@
+//
+//  meshlet_culling.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/8/25.
+//
+
+#ifndef meshlet_culling_hpp
+#define meshlet_culling_hpp
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "culling.hpp"
+#include "geometry_arena.hpp"
+#include "meshlets.hpp"
+
+struct MeshletCullStats {
+    size_t tested = 0;
+    size_t frustumCulled = 0;
+    size_t coneCulled = 0;
+    size_t visibleTriangles = 0;
+
+    size_t visible() const { return tested - frustumCulled - coneCulled; }
+};
+
+// Per-frame meshlet culling of one arena mesh. Every (instance, meshlet) pair is tested against
+// the camera-relative frustum and the back-face cone on the worker threads; each run of adjacent
+// visible meshlets of an instance becomes one draw of the DrawList, so the GPU only sees the
+// compacted index ranges.
+class MeshletCuller {
+public:
+    // meshlets index the arena mesh's own index range. Appends to drawList without clearing it.
+    void cull(const std::vector<Meshlet>& meshlets, const ArenaMesh& mesh, const std::vector<Instance>& instances,
+              const std::vector<uint32_t>& instanceIds, const glm::mat4& relativeModel, const Frustum& frustum,
+              bool coneCulling, DrawList& drawList, MeshletCullStats* stats = nullptr);
+
+private:
+    enum Result : uint8_t { Visible, OutsideFrustum, BackFacing };
+
+    struct InstanceTransform {
+        glm::mat4 model;     // camera-relative
+        float maxScale;
+        bool coneValid;      // cones survive rotation and uniform scale only
+    };
+
+    std::vector<InstanceTransform> transforms;
+    std::vector<uint8_t> results;   // instance-major
+};
+
+#endif /* meshlet_culling_hpp */
@@ -0,0 +1,192 @@
+//
+//  multi_view.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 6/30/25.
+//
+
+#include "multi_view.hpp"
+#include "shader_utils.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <string>
+
+namespace {
+
+const char* kVertexShaderSource = R"(
+    #version 330 core
+    layout(location = 0) in vec3 aPos;
+    layout(location = 1) in vec3 aColor;
+    layout(location = 2) in mat4 aInstanceModel;
+    layout(location = 6) in vec4 aInstanceColor;
+    out vec3 vColor;
+    flat out int vViewIndex;
+    uniform mat4 uModelViewProjection[4];
+    uniform int uViewBase;
+    uniform int uViewCount;
+
+    void main() {
+        int view = uViewBase + gl_InstanceID % uViewCount;
+        vColor = aColor * aInstanceColor.rgb;
+        vViewIndex = view;
+        gl_Position = uModelViewProjection[view] * aInstanceModel * vec4(aPos, 1.0);
+    }
+)";
+
+// Version line is prepended at init: viewport arrays are core in 4.1, an extension before that
+const char* kGeometryShaderBody = R"(
+    layout(triangles) in;
+    layout(triangle_strip, max_vertices = 3) out;
+    in vec3 vColor[];
+    flat in int vViewIndex[];
+    out vec3 gColor;
+
+    void main() {
+        for (int i = 0; i < 3; ++i) {
+            gl_ViewportIndex = vViewIndex[0];
+            gl_Position = gl_in[i].gl_Position;
+            gColor = vColor[i];
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+)";
+
+const char* kFragmentShaderSource = R"(
+    #version 330 core
+    in vec3 gColor;
+    out vec4 FragColor;
+    void main() {
+        FragColor = vec4(gColor, 1.0);
+    }
+)";
+
+// The fallback program skips the geometry stage, so its fragment input keeps the vertex name
+const char* kFallbackFragmentShaderSource = R"(
+    #version 330 core
+    in vec3 vColor;
+    out vec4 FragColor;
+    void main() {
+        FragColor = vec4(vColor, 1.0);
+    }
+)";
+
+}
+
+bool MultiView::init(Camera* primary) {
+    for (int i = 0; i < kViewCount - 1; ++i) {
+        orthoCameras[i].setProjectionType(Camera::ProjectionType::Orthographic);
+        cameras[i] = &orthoCameras[i];
+    }
+    cameras[kViewCount - 1] = primary;
+
+    viewportArray = GLEW_VERSION_4_1 || GLEW_ARB_viewport_array;
+    if (viewportArray) {
+        std::string geometrySource = GLEW_VERSION_4_1
+            ? std::string("#version 410 core\n") + kGeometryShaderBody
+            : std::string("#version 330 core\n#extension GL_ARB_viewport_array : require\n") + kGeometryShaderBody;
+        program = buildProgram(kVertexShaderSource, geometrySource.c_str(), kFragmentShaderSource);
+        viewportArray = program != 0;
+    }
+    if (!viewportArray)
+        program = buildProgram(kVertexShaderSource, nullptr, kFallbackFragmentShaderSource);
+    if (!program)
+        return false;
+
+    mvpLoc = glGetUniformLocation(program, "uModelViewProjection");
+    viewBaseLoc = glGetUniformLocation(program, "uViewBase");
+    viewCountLoc = glGetUniformLocation(program, "uViewCount");
+    update();
+    return true;
+}
+
+void MultiView::cleanup() {
+    glDeleteProgram(program);
+    program = 0;
+    for (Camera& camera : orthoCameras)
+        camera.cleanup();
+}
+
+void MultiView::update() {
+    const Camera& primary = *cameras[kViewCount - 1];
+    CameraState state = primary.getState();
+    double distance = glm::length(state.eye - state.ref);
+
+    // Same window and depth range as the primary, which frameBounds() scales to the model
+    for (Camera& camera : orthoCameras)
+        camera.copyLimits(primary);
+
+    orthoCameras[0].lookAt(state.ref + glm::dvec3(0.0, distance, 0.0), state.ref, glm::dvec3(0.0, 0.0, -1.0)); // top
+    orthoCameras[1].lookAt(state.ref + glm::dvec3(0.0, 0.0, distance), state.ref, glm::dvec3(0.0, 1.0, 0.0));  // front
+    orthoCameras[2].lookAt(state.ref + glm::dvec3(distance, 0.0, 0.0), state.ref, glm::dvec3(0.0, 1.0, 0.0));  // side
+}
+
+void MultiView::setViewport(int width, int height) {
+    fullWidth = width;
+    fullHeight = height;
+    int halfWidth = std::max(width / 2, 1);
+    int halfHeight = std::max(height / 2, 1);
+
+    // Top-left, top-right, bottom-left, bottom-right (GL origin is bottom-left)
+    for (int i = 0; i < kViewCount; ++i) {
+        rects[i].x = (i % 2) * halfWidth;
+        rects[i].y = (i < 2) ? halfHeight : 0;
+        rects[i].width = halfWidth;
+        rects[i].height = halfHeight;
+        cameras[i]->setViewport(halfWidth, halfHeight);
+    }
+}
+
+size_t MultiView::cull(const CullingSet& set, std::vector<uint64_t>& visibility, CullStats* stats) const {
+    const glm::dvec3& origin = cameras[kViewCount - 1]->getEyePosition();
+
+    std::vector<uint64_t> viewVisibility;
+    visibility.assign((set.size() + 63) / 64, 0);
+    for (int i = 0; i < kViewCount; ++i) {
+        // Each frustum lives in its own camera-relative space, shift it to the primary one
+        glm::vec3 offset = glm::vec3(origin - cameras[i]->getEyePosition());
+        set.cull(offsetFrustum(cameras[i]->getFrustum(), offset), viewVisibility);
+        for (size_t word = 0; word < visibility.size(); ++word)
+            visibility[word] |= viewVisibility[word];
+    }
+
+    size_t visible = 0;
+    for (uint64_t word : visibility)
+        visible += static_cast<size_t>(__builtin_popcountll(word));
+
+    if (stats) {
+        stats->tested += set.size();
+        stats->visible += visible;
+    }
+    return visible;
+}
+
+void MultiView::draw(const Mesh& mesh, const glm::dmat4& model) const {
+    glm::mat4 modelViewProjection[kViewCount];
+    for (int i = 0; i < kViewCount; ++i)
+        modelViewProjection[i] = cameras[i]->getModelViewProjectionMatrix(model);
+
+    glUseProgram(program);
+    glUniformMatrix4fv(mvpLoc, kViewCount, GL_FALSE, glm::value_ptr(modelViewProjection[0]));
+
+    if (viewportArray) {
+        for (int i = 0; i < kViewCount; ++i) {
+            glViewportIndexedf(i, static_cast<float>(rects[i].x), static_cast<float>(rects[i].y),
+                               static_cast<float>(rects[i].width), static_cast<float>(rects[i].height));
+        }
+        glUniform1i(viewBaseLoc, 0);
+        glUniform1i(viewCountLoc, kViewCount);
+        mesh.drawInstanced(kViewCount);
+    } else {
+        glUniform1i(viewCountLoc, 1);
+        for (int i = 0; i < kViewCount; ++i) {
+            glViewport(rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+            glUniform1i(viewBaseLoc, i);
+            mesh.draw();
+        }
+    }
+
+    // glViewport resets every viewport index, so later full-window passes are unaffected
+    glViewport(0, 0, fullWidth, fullHeight);
+}
@@ -0,0 +1,58 @@
+//
+//  multi_view.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 6/30/25.
+//
+
+#ifndef multi_view_hpp
+#define multi_view_hpp
+
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+#include "camera.hpp"
+#include "culling.hpp"
+#include "mesh.hpp"
+
+// Top / front / side orthographic views plus the interactive perspective camera in a 2x2 grid.
+// With GL_ARB_viewport_array every view is drawn by one instanced call whose geometry shader
+// routes instance i to viewport i; otherwise each view gets its own pass.
+class MultiView {
+public:
+    static constexpr int kViewCount = 4;
+
+    bool init(Camera* primary);
+    void cleanup();
+
+    // Keeps the orthographic views aimed at the primary camera's target, framing its extent
+    void update();
+    void setViewport(int width, int height);
+
+    // Shared culling: an entry is visible when any view sees it. Bounds in the set are
+    // relative to the primary camera's eye, like the primary frustum.
+    size_t cull(const CullingSet& set, std::vector<uint64_t>& visibility, CullStats* stats = nullptr) const;
+
+    void draw(const Mesh& mesh, const glm::dmat4& model) const;
+
+    bool isReady() const { return program != 0; }
+    bool usesViewportArray() const { return viewportArray; }
+
+private:
+    struct Rect {
+        int x = 0, y = 0, width = 1, height = 1;
+    };
+
+    Camera* cameras[kViewCount] = {};
+    Camera orthoCameras[kViewCount - 1];
+    Rect rects[kViewCount];
+    int fullWidth = 1, fullHeight = 1;
+
+    bool viewportArray = false;
+    GLuint program = 0;
+    GLint mvpLoc = -1, viewBaseLoc = -1, viewCountLoc = -1;
+};
+
+#endif /* multi_view_hpp */
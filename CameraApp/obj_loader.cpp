@@ -0,0 +1,460 @@
+//
+//  obj_loader.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/12/25.
+//
+
+#include "obj_loader.hpp"
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <mutex>
+
+namespace {
+
+constexpr size_t kMinChunkBytes = 1 << 20;
+// Set on corners given as negative (relative) indices: the low 31 bits hold a signed offset from
+// the chunk's first position, resolved once the chunks before it are counted
+constexpr uint32_t kRelativeCorner = 0x80000000u;
+constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+struct ObjChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> colors;   // empty until the chunk meets a colored vertex
+    std::vector<uint32_t> corners;   // three per triangle
+    size_t skippedLines = 0;
+    const char* firstSkipped = nullptr;
+};
+
+// Serializes progress callbacks and drops the ones that would not move the value by a percent
+class ProgressReporter {
+public:
+    explicit ProgressReporter(const LoadProgress& callback) : callback(callback) {}
+
+    void report(float fraction) {
+        if (!callback)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fraction - last >= 0.01f || (fraction >= 1.0f && last < 1.0f)) {
+            last = fraction;
+            callback(fraction);
+        }
+    }
+
+private:
+    const LoadProgress& callback;
+    std::mutex mutex;
+    float last = 0.0f;
+};
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p))
+        ++p;
+    return p;
+}
+
+// Locale-free decimal parser. The first 19 significant digits are kept exactly; when they fit a
+// double and the power of ten is at most 1e22 the result is correctly rounded (Clinger's fast
+// path), otherwise it is within a few double ulps, far below float precision.
+// Returns nullptr when there is no number at p.
+const char* parseFloat(const char* p, const char* end, float& value) {
+    static const double kPowersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    p = skipBlanks(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int exponent = 0, digits = 0;
+    bool any = false;
+    for (; p < end && isDigit(*p); ++p) {
+        any = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            digits += mantissa != 0;
+        } else {
+            ++exponent;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && isDigit(*p); ++p) {
+            any = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                digits += mantissa != 0;
+                --exponent;
+            }
+        }
+    }
+    if (!any)
+        return nullptr;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            negativeExponent = *q == '-';
+            ++q;
+        }
+        if (q < end && isDigit(*q)) {
+            int e = 0;
+            for (; q < end && isDigit(*q); ++q)
+                e = std::min(e * 10 + (*q - '0'), 10000);
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+
+    double result = static_cast<double>(mantissa);
+    if (mantissa != 0) {
+        bool exactMantissa = mantissa < (uint64_t(1) << 53);
+        if (exactMantissa && exponent >= 0 && exponent <= 22)
+            result *= kPowersOfTen[exponent];
+        else if (exactMantissa && exponent < 0 && exponent >= -22)
+            result /= kPowersOfTen[-exponent];
+        else
+            result *= std::pow(10.0, exponent);
+    }
+    value = static_cast<float>(negative ? -result : result);
+    return p;
+}
+
+const char* parseInt(const char* p, const char* end, long long& value) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    if (p >= end || !isDigit(*p))
+        return nullptr;
+    long long result = 0;
+    for (; p < end && isDigit(*p); ++p)
+        result = std::min(result * 10 + (*p - '0'), 1LL << 40);
+    value = negative ? -result : result;
+    return p;
+}
+
+bool parseVertex(ObjChunk& chunk, const char* p, const char* end) {
+    float values[6];
+    for (int i = 0; i < 3; ++i) {
+        p = parseFloat(p, end, values[i]);
+        if (!p)
+            return false;
+    }
+    // "v x y z r g b" carries a color, "v x y z w" a weight we ignore
+    int extra = 0;
+    while (extra < 3) {
+        const char* next = parseFloat(p, end, values[3 + extra]);
+        if (!next)
+            break;
+        p = next;
+        ++extra;
+    }
+
+    if (extra == 3) {
+        if (chunk.colors.size() < chunk.positions.size())
+            chunk.colors.resize(chunk.positions.size(), glm::vec3(1.0f));
+        chunk.colors.push_back(glm::vec3(values[3], values[4], values[5]));
+    } else if (!chunk.colors.empty()) {
+        chunk.colors.push_back(glm::vec3(1.0f));
+    }
+    chunk.positions.push_back(glm::vec3(values[0], values[1], values[2]));
+    return true;
+}
+
+bool parseFace(ObjChunk& chunk, const char* p, const char* end) {
+    uint32_t first = 0, previous = 0;
+    int count = 0;
+    for (p = skipBlanks(p, end); p < end; p = skipBlanks(p, end)) {
+        long long reference;
+        const char* next = parseInt(p, end, reference);
+        if (!next || reference == 0)
+            return false;
+        // Texture coordinate and normal references ("/vt/vn", "//vn") are not used
+        while (next < end && !isBlank(*next))
+            ++next;
+        p = next;
+
+        uint32_t corner;
+        if (reference > 0) {
+            if (reference > kRelativeCorner)
+                return false;
+            corner = static_cast<uint32_t>(reference - 1);
+        } else {
+            long long offset = static_cast<long long>(chunk.positions.size()) + reference;
+            if (offset < -(1LL << 30))
+                return false;
+            corner = kRelativeCorner | (static_cast<uint32_t>(offset) & ~kRelativeCorner);
+        }
+
+        if (count == 0) {
+            first = corner;
+        } else if (count >= 2) {
+            chunk.corners.push_back(first);
+            chunk.corners.push_back(previous);
+            chunk.corners.push_back(corner);
+        }
+        previous = corner;
+        ++count;
+    }
+    return true;
+}
+
+void parseChunk(ObjChunk& chunk) {
+    const char* p = chunk.begin;
+    while (p < chunk.end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+        if (!lineEnd)
+            lineEnd = chunk.end;
+
+        const char* q = skipBlanks(p, lineEnd);
+        bool parsed = true;
+        if (lineEnd - q >= 2 && q[0] == 'v' && isBlank(q[1]))
+            parsed = parseVertex(chunk, q + 2, lineEnd);
+        else if (lineEnd - q >= 2 && q[0] == 'f' && isBlank(q[1]))
+            parsed = parseFace(chunk, q + 2, lineEnd);
+
+        if (!parsed) {
+            if (!chunk.firstSkipped)
+                chunk.firstSkipped = p;
+            ++chunk.skippedLines;
+        }
+        p = lineEnd + 1;
+    }
+}
+
+inline float canonicalZero(float value) {
+    // -0 and +0 must weld together
+    return value == 0.0f ? 0.0f : value;
+}
+
+uint64_t hashVertex(const Vertex& vertex) {
+    const float values[6] = {
+        vertex.position.x, vertex.position.y, vertex.position.z,
+        vertex.color.x, vertex.color.y, vertex.color.z
+    };
+    uint64_t hash = 14695981039346656037ull;
+    for (float value : values) {
+        float canonical = canonicalZero(value);
+        uint32_t bits;
+        std::memcpy(&bits, &canonical, sizeof(bits));
+        hash = (hash ^ bits) * 1099511628211ull;
+    }
+    // FNV-1a mixes the low bits poorly, the partition comes from the top ones
+    hash ^= hash >> 29;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+inline bool sameVertex(const Vertex& a, const Vertex& b) {
+    return a.position.x == b.position.x && a.position.y == b.position.y && a.position.z == b.position.z
+        && a.color.x == b.color.x && a.color.y == b.color.y && a.color.z == b.color.z;
+}
+
+// Merges identical vertices. Vertices are bucketed by the top bits of their hash, and each bucket
+// is deduplicated with its own open-addressing table on a worker thread; the first occurrence
+// wins, so the result is deterministic.
+void weldVertices(std::vector<Vertex>& vertices, std::vector<GLuint>& indices) {
+    constexpr unsigned kPartitionBits = 8;
+    constexpr size_t kPartitions = size_t(1) << kPartitionBits;
+    size_t count = vertices.size();
+
+    std::vector<uint64_t> hashes(count);
+    parallelFor(count, 1 << 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            hashes[i] = hashVertex(vertices[i]);
+    });
+
+    std::vector<size_t> partitionStart(kPartitions + 1, 0);
+    for (uint64_t hash : hashes)
+        ++partitionStart[(hash >> (64 - kPartitionBits)) + 1];
+    for (size_t p = 0; p < kPartitions; ++p)
+        partitionStart[p + 1] += partitionStart[p];
+    std::vector<uint32_t> order(count);
+    std::vector<size_t> cursor(partitionStart.begin(), partitionStart.end() - 1);
+    for (size_t i = 0; i < count; ++i)
+        order[cursor[hashes[i] >> (64 - kPartitionBits)]++] = static_cast<uint32_t>(i);
+
+    std::vector<uint32_t> canonical(count);
+    parallelFor(kPartitions, 1, [&](size_t begin, size_t end) {
+        std::vector<uint32_t> table;
+        for (size_t p = begin; p < end; ++p) {
+            size_t size = partitionStart[p + 1] - partitionStart[p];
+            size_t capacity = 16;
+            while (capacity < size * 2)
+                capacity *= 2;
+            table.assign(capacity, kInvalidIndex);
+
+            for (size_t k = partitionStart[p]; k < partitionStart[p + 1]; ++k) {
+                uint32_t vertex = order[k];
+                size_t slot = hashes[vertex] & (capacity - 1);
+                while (table[slot] != kInvalidIndex
+                       && !(hashes[table[slot]] == hashes[vertex] && sameVertex(vertices[table[slot]], vertices[vertex])))
+                    slot = (slot + 1) & (capacity - 1);
+                if (table[slot] == kInvalidIndex)
+                    table[slot] = vertex;
+                canonical[vertex] = table[slot];
+            }
+        }
+    });
+
+    // Duplicates always come after their canonical vertex, which is already numbered
+    std::vector<uint32_t> remap(count);
+    size_t unique = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (canonical[i] == i) {
+            remap[i] = static_cast<uint32_t>(unique);
+            vertices[unique++] = vertices[i];
+        } else {
+            remap[i] = remap[canonical[i]];
+        }
+    }
+    vertices.resize(unique);
+    vertices.shrink_to_fit();
+
+    parallelFor(indices.size(), 1 << 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            indices[i] = remap[indices[i]];
+    });
+}
+
+}
+
+bool loadObj(const std::string& path, std::vector<Vertex>& vertices, std::vector<GLuint>& indices,
+             const LoadProgress& progress, ObjLoadStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    vertices.clear();
+    indices.clear();
+
+    MappedFile file;
+    if (!file.open(path, MappedFile::Access::Sequential))
+        return false;
+    const char* data = file.data();
+    const char* end = data + file.size();
+    ProgressReporter reporter(progress);
+
+    // Several chunks per worker even out lines of very different cost (faces vs. vertices)
+    size_t chunkBytes = std::max(kMinChunkBytes, file.size() / (workerCount() * 8));
+    std::vector<ObjChunk> chunks;
+    for (const char* cursor = data; cursor < end;) {
+        const char* chunkEnd = cursor + std::min(chunkBytes, static_cast<size_t>(end - cursor));
+        if (chunkEnd < end) {
+            const char* newline = static_cast<const char*>(std::memchr(chunkEnd, '\n', end - chunkEnd));
+            chunkEnd = newline ? newline + 1 : end;
+        }
+        chunks.emplace_back();
+        chunks.back().begin = cursor;
+        chunks.back().end = chunkEnd;
+        cursor = chunkEnd;
+    }
+
+    // Parsing is most of the work, merging and welding share the last 15%
+    std::atomic<size_t> parsedBytes(0);
+    parallelFor(chunks.size(), 1, [&](size_t begin, size_t last) {
+        for (size_t c = begin; c < last; ++c) {
+            parseChunk(chunks[c]);
+            size_t done = parsedBytes.fetch_add(chunks[c].end - chunks[c].begin) + (chunks[c].end - chunks[c].begin);
+            reporter.report(0.85f * static_cast<float>(done) / static_cast<float>(file.size()));
+        }
+    });
+
+    size_t positionCount = 0, cornerCount = 0, skippedLines = 0;
+    const char* firstSkipped = nullptr;
+    std::vector<size_t> positionBase(chunks.size()), cornerBase(chunks.size());
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        positionBase[c] = positionCount;
+        cornerBase[c] = cornerCount;
+        positionCount += chunks[c].positions.size();
+        cornerCount += chunks[c].corners.size();
+        skippedLines += chunks[c].skippedLines;
+        if (!firstSkipped)
+            firstSkipped = chunks[c].firstSkipped;
+    }
+    if (skippedLines > 0) {
+        size_t line = 1 + std::count(data, firstSkipped, '\n');
+        std::cerr << path << ":" << line << ": skipped " << skippedLines << " malformed vertex/face line(s), this is the first\n";
+    }
+    if (positionCount > kRelativeCorner || cornerCount == 0) {
+        std::cerr << path << ": " << (cornerCount == 0 ? "no faces" : "too many vertices") << "\n";
+        return false;
+    }
+
+    // Concatenate the chunks and resolve relative corners against the positions before them
+    vertices.resize(positionCount);
+    indices.resize(cornerCount);
+    std::atomic<bool> outOfRange(false);
+    parallelFor(chunks.size(), 1, [&](size_t begin, size_t last) {
+        for (size_t c = begin; c < last; ++c) {
+            ObjChunk& chunk = chunks[c];
+            Vertex* out = &vertices[positionBase[c]];
+            for (size_t i = 0; i < chunk.positions.size(); ++i) {
+                out[i].position = chunk.positions[i];
+                out[i].color = chunk.colors.empty() ? glm::vec3(1.0f) : chunk.colors[i];
+            }
+
+            GLuint* corners = indices.data() + cornerBase[c];
+            for (size_t i = 0; i < chunk.corners.size(); ++i) {
+                uint32_t corner = chunk.corners[i];
+                long long index = corner;
+                if (corner & kRelativeCorner) {
+                    // Sign-extend the 31-bit offset
+                    int32_t offset = static_cast<int32_t>(corner << 1) >> 1;
+                    index = static_cast<long long>(positionBase[c]) + offset;
+                }
+                if (index < 0 || index >= static_cast<long long>(positionCount)) {
+                    outOfRange = true;
+                    index = 0;
+                }
+                corners[i] = static_cast<GLuint>(index);
+            }
+
+            std::vector<glm::vec3>().swap(chunk.positions);
+            std::vector<glm::vec3>().swap(chunk.colors);
+            std::vector<uint32_t>().swap(chunk.corners);
+        }
+    });
+    if (outOfRange) {
+        std::cerr << path << ": face refers to a vertex that does not exist\n";
+        vertices.clear();
+        indices.clear();
+        return false;
+    }
+    reporter.report(0.9f);
+
+    weldVertices(vertices, indices);
+    reporter.report(1.0f);
+
+    if (stats) {
+        stats->positions = positionCount;
+        stats->triangles = indices.size() / 3;
+        stats->weldedVertices = vertices.size();
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+//
+//  obj_loader.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/12/25.
+//
+
+#ifndef obj_loader_hpp
+#define obj_loader_hpp
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+
+// Fraction of a load done so far, in [0, 1]. May be called from worker threads, never from two
+// at once, and only when the value moved by at least a percent.
+using LoadProgress = std::function<void(float)>;
+
+struct ObjLoadStats {
+    size_t positions = 0;       // "v" lines
+    size_t triangles = 0;
+    size_t weldedVertices = 0;  // vertices after merging identical position/color pairs
+    double seconds = 0.0;
+};
+
+// Loads a Wavefront OBJ into the Mesh layout. Reads "v x y z" with the optional "r g b" vertex
+// color extension (white otherwise) and "f" faces with any corner syntax, negative indices
+// included; polygons are fan-triangulated, everything else (normals, texture coordinates,
+// groups, materials) is skipped. The file is memory-mapped and parsed in line-aligned chunks on
+// the worker threads, then identical vertices are welded. Reports errors on std::cerr.
+bool loadObj(const std::string& path, std::vector<Vertex>& vertices, std::vector<GLuint>& indices,
+             const LoadProgress& progress = LoadProgress(), ObjLoadStats* stats = nullptr);
+
+#endif /* obj_loader_hpp */
@@ -0,0 +1,66 @@
+//
+//  object_constants.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/24/25.
+//
+
+#include "object_constants.hpp"
+
+#include <cstring>
+
+ObjectConstants makeObjectConstants(const Camera& camera, const glm::dmat4& model, uint32_t objectId)
+{
+    ObjectConstants constants;
+    constants.modelViewProjection = camera.getModelViewProjectionMatrix(model);
+    constants.modelView = camera.getModelViewMatrix(model);
+    constants.object = glm::uvec4(objectId, 0, 0, 0);
+    return constants;
+}
+
+bool ObjectConstantsRing::init(size_t maxDrawsPerFrame)
+{
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    stride = (static_cast<GLsizeiptr>(sizeof(ObjectConstants)) + alignment - 1) / alignment * alignment;
+
+    return stream.init(GL_UNIFORM_BUFFER, maxDrawsPerFrame * stride);
+}
+
+void ObjectConstantsRing::cleanup()
+{
+    stream.cleanup();
+}
+
+ObjectConstantsBatch ObjectConstantsRing::upload(const ObjectConstants* constants, size_t count)
+{
+    ObjectConstantsBatch batch;
+    StreamAllocation allocation = stream.allocate(count * stride, static_cast<size_t>(stride));
+    if (!allocation.isValid())
+        return batch;
+
+    unsigned char* destination = static_cast<unsigned char*>(allocation.data);
+    for (size_t i = 0; i < count; ++i)
+        std::memcpy(destination + i * stride, &constants[i], sizeof(ObjectConstants));
+    stream.flush();
+
+    batch.offset = allocation.offset;
+    batch.stride = stride;
+    batch.count = count;
+    return batch;
+}
+
+void ObjectConstantsRing::bind(const ObjectConstantsBatch& batch, size_t index) const
+{
+    if (index >= batch.count)
+        return;
+    glBindBufferRange(GL_UNIFORM_BUFFER, kUniformBinding, stream.getBuffer(),
+                      batch.offset + static_cast<GLintptr>(index) * batch.stride, sizeof(ObjectConstants));
+}
+
+void ObjectConstantsRing::bindUniformBlock(GLuint shaderProgram)
+{
+    GLuint blockIndex = glGetUniformBlockIndex(shaderProgram, "ObjectBlock");
+    if (blockIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(shaderProgram, blockIndex, kUniformBinding);
+}
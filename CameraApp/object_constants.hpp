@@ -0,0 +1,62 @@
+//
+//  object_constants.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/24/25.
+//
+
+#ifndef object_constants_hpp
+#define object_constants_hpp
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+
+#include "camera.hpp"
+#include "stream_buffer.hpp"
+
+// Mirrors the std140 "ObjectBlock" uniform block: everything a draw needs besides the camera
+struct ObjectConstants
+{
+    glm::mat4 modelViewProjection;   // camera-relative, composed in double
+    glm::mat4 modelView;             // for view-space distances, e.g. point sizes
+    glm::uvec4 object;               // x: object ID of the first instance
+};
+
+ObjectConstants makeObjectConstants(const Camera& camera, const glm::dmat4& model, uint32_t objectId);
+
+struct ObjectConstantsBatch
+{
+    GLintptr offset = 0;
+    GLsizeiptr stride = 0;
+    size_t count = 0;
+};
+
+// Per-draw constants written in batches into a streamed uniform buffer; a draw selects its
+// slot with glBindBufferRange instead of a glUniform* call per matrix.
+class ObjectConstantsRing
+{
+public:
+    static constexpr GLuint kUniformBinding = 1;
+
+    bool init(size_t maxDrawsPerFrame);
+    void cleanup();
+
+    void beginFrame() { stream.beginFrame(); }
+    void endFrame() { stream.endFrame(); }
+
+    // Copies count constants into consecutive aligned slots; count is 0 on overflow
+    ObjectConstantsBatch upload(const ObjectConstants* constants, size_t count);
+    void bind(const ObjectConstantsBatch& batch, size_t index) const;
+
+    // Points a program's "ObjectBlock" at kUniformBinding; call once after linking
+    static void bindUniformBlock(GLuint shaderProgram);
+
+private:
+    StreamBuffer stream;
+    GLsizeiptr stride = 0;
+};
+
+#endif /* object_constants_hpp */
@@ -0,0 +1,77 @@
+//
+//  picking.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/7/25.
+//
+
+#include "picking.hpp"
+
+int ScenePicker::addObject(const TriangleBvh* meshBvh, const glm::dmat4& model) {
+    objects.push_back({ meshBvh, model, glm::inverse(model) });
+    dirty = true;
+    return static_cast<int>(objects.size()) - 1;
+}
+
+void ScenePicker::setTransform(int object, const glm::dmat4& model) {
+    objects[object].model = model;
+    objects[object].inverseModel = glm::inverse(model);
+    dirty = true;
+}
+
+void ScenePicker::clear() {
+    objects.clear();
+    objectBvh.clear();
+    dirty = true;
+}
+
+void ScenePicker::rebuild() {
+    sceneOrigin = glm::dvec3(0.0);
+    for (const Object& object : objects)
+        sceneOrigin += glm::dvec3(object.model[3]) / static_cast<double>(objects.size());
+
+    std::vector<BoundingBox> bounds;
+    bounds.reserve(objects.size());
+    for (const Object& object : objects) {
+        glm::dmat4 relative = object.model;
+        relative[3] -= glm::dvec4(sceneOrigin, 0.0);
+        bounds.push_back(transformBounds(object.meshBvh->getBounds(), glm::mat4(relative)));
+    }
+
+    objectBvh.build(bounds);
+    dirty = false;
+}
+
+bool ScenePicker::pick(const glm::dvec3& origin, const glm::dvec3& direction, PickResult& result) {
+    if (dirty)
+        rebuild();
+
+    Ray sceneRay{ glm::vec3(origin - sceneOrigin), glm::vec3(direction) };
+    const std::vector<uint32_t>& objectOrder = objectBvh.getPrimitiveIndices();
+
+    RayHit best;
+    int bestObject = -1;
+    float tMax = best.distance;
+    objectBvh.traverse(sceneRay, tMax, [&](uint32_t slot, float& limit) {
+        const Object& object = objects[objectOrder[slot]];
+
+        // An affine transform keeps ray distances, so hits in every object compare directly
+        Ray localRay;
+        localRay.origin = glm::vec3(object.inverseModel * glm::dvec4(origin, 1.0));
+        localRay.direction = glm::vec3(object.inverseModel * glm::dvec4(direction, 0.0));
+
+        if (object.meshBvh->intersect(localRay, best)) {
+            bestObject = static_cast<int>(objectOrder[slot]);
+            limit = best.distance;
+        }
+    });
+
+    if (bestObject < 0)
+        return false;
+
+    result.object = bestObject;
+    result.triangle = best.triangle;
+    result.distance = best.distance;
+    result.position = origin + direction * static_cast<double>(best.distance);
+    return true;
+}
@@ -0,0 +1,51 @@
+//
+//  picking.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/7/25.
+//
+
+#ifndef picking_hpp
+#define picking_hpp
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "bvh.hpp"
+
+struct PickResult {
+    int object = -1;
+    uint32_t triangle = 0;
+    double distance = 0.0;   // from the ray origin, along the normalized world ray
+    glm::dvec3 position;     // world-space hit point
+};
+
+// Two-level picking: a BVH over object world bounds on top of one TriangleBvh per mesh.
+// Object bounds are stored relative to a scene origin so float boxes stay precise far
+// from the world origin.
+class ScenePicker {
+public:
+    int addObject(const TriangleBvh* meshBvh, const glm::dmat4& model);
+    void setTransform(int object, const glm::dmat4& model);
+    void clear();
+
+    bool pick(const glm::dvec3& origin, const glm::dvec3& direction, PickResult& result);
+
+private:
+    struct Object {
+        const TriangleBvh* meshBvh;
+        glm::dmat4 model;
+        glm::dmat4 inverseModel;
+    };
+
+    std::vector<Object> objects;
+    Bvh objectBvh;
+    glm::dvec3 sceneOrigin = glm::dvec3(0.0);
+    bool dirty = true;
+
+    void rebuild();
+};
+
+#endif /* picking_hpp */
@@ -0,0 +1,279 @@
+//
+//  ply_loader.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/19/25.
+//
+
+#include "ply_loader.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+// Far more than any real header, comments included; keeps a missing end_header from scanning the file
+constexpr size_t kMaxHeaderBytes = size_t(1) << 20;
+
+template <typename T>
+T readRaw(const char* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+}
+
+bool PlyPointReader::open(const std::string& path) {
+    close();
+    if (!file.open(path, MappedFile::Access::Sequential))
+        return false;
+    if (!parseHeader(path)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool PlyPointReader::parseHeader(const std::string& path) {
+    const char* data = file.data();
+    size_t size = file.size();
+    static const char kEndHeader[] = "end_header";
+    const char* searchEnd = data + std::min(size, kMaxHeaderBytes);
+    const char* end = size < 4 || std::memcmp(data, "ply", 3) != 0 ? searchEnd
+                    : std::search(data, searchEnd, kEndHeader, kEndHeader + sizeof(kEndHeader) - 1);
+    const char* newline = end == searchEnd ? nullptr : static_cast<const char*>(std::memchr(end, '\n', searchEnd - end));
+    if (!newline) {
+        std::cerr << path << ": not a PLY file\n";
+        return false;
+    }
+
+    auto typeOf = [](const std::string& name, size_t& bytes) {
+        static const struct { const char* names[2]; PropertyType type; size_t bytes; } kTypes[] = {
+            { { "char", "int8" }, PropertyType::Int8, 1 },     { { "uchar", "uint8" }, PropertyType::UInt8, 1 },
+            { { "short", "int16" }, PropertyType::Int16, 2 },  { { "ushort", "uint16" }, PropertyType::UInt16, 2 },
+            { { "int", "int32" }, PropertyType::Int32, 4 },    { { "uint", "uint32" }, PropertyType::UInt32, 4 },
+            { { "float", "float32" }, PropertyType::Float32, 4 }, { { "double", "float64" }, PropertyType::Float64, 8 },
+        };
+        for (const auto& entry : kTypes) {
+            if (name == entry.names[0] || name == entry.names[1]) {
+                bytes = entry.bytes;
+                return entry.type;
+            }
+        }
+        bytes = 0;
+        return PropertyType::None;
+    };
+
+    // Elements ahead of the vertices only need their byte size, which lists make unknowable
+    std::istringstream header(std::string(data, end));
+    std::string line;
+    bool binaryLittleEndian = false;
+    bool inVertex = false, vertexSeen = false, sizeKnown = true;
+    size_t skipBytes = 0, elementCount = 0, elementSize = 0;
+    auto closeElement = [&]() {
+        if (!inVertex && !vertexSeen)
+            skipBytes += elementCount * elementSize;
+        if (inVertex) {
+            vertexStride = elementSize;
+            vertexSeen = true;
+        }
+        inVertex = false;
+    };
+    while (std::getline(header, line)) {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+        if (keyword == "format") {
+            std::string format;
+            words >> format;
+            binaryLittleEndian = format == "binary_little_endian";
+        } else if (keyword == "element") {
+            closeElement();
+            std::string name;
+            words >> name >> elementCount;
+            elementSize = 0;
+            inVertex = name == "vertex" && !vertexSeen;
+            if (inVertex)
+                pointCount = elementCount;
+        } else if (keyword == "property") {
+            std::string type, name;
+            words >> type >> name;
+            size_t bytes = 0;
+            PropertyType propertyType = typeOf(type, bytes);
+            if (type == "list" || propertyType == PropertyType::None) {
+                if (inVertex || !vertexSeen)
+                    sizeKnown = false;
+                continue;
+            }
+            if (inVertex) {
+                static const char* kPositionNames[3] = { "x", "y", "z" };
+                static const char* kColorNames[3] = { "red", "green", "blue" };
+                for (int axis = 0; axis < 3; ++axis) {
+                    if (name == kPositionNames[axis])
+                        positionProperties[axis] = { propertyType, elementSize };
+                    if (name == kColorNames[axis])
+                        colorProperties[axis] = { propertyType, elementSize };
+                }
+            }
+            elementSize += bytes;
+        }
+    }
+    closeElement();
+
+    if (!binaryLittleEndian) {
+        std::cerr << path << ": only binary little-endian PLY is supported\n";
+        return false;
+    }
+    if (!vertexSeen || !sizeKnown || pointCount == 0) {
+        std::cerr << path << ": needs a non-empty vertex element of fixed-size properties, after no list elements\n";
+        return false;
+    }
+    if (positionProperties[0].type == PropertyType::None || positionProperties[1].type == PropertyType::None
+        || positionProperties[2].type == PropertyType::None) {
+        std::cerr << path << ": vertices have no x, y and z\n";
+        return false;
+    }
+    // Color needs all three channels
+    for (const Property& channel : colorProperties) {
+        if (channel.type == PropertyType::None) {
+            for (Property& reset : colorProperties)
+                reset = Property();
+            break;
+        }
+    }
+
+    // A scan cut short still shows what made it to disk
+    size_t dataOffset = static_cast<size_t>(newline + 1 - data) + skipBytes;
+    size_t available = dataOffset < size ? (size - dataOffset) / vertexStride : 0;
+    if (available < pointCount) {
+        std::cerr << path << ": truncated, reading " << available << " of " << pointCount << " points\n";
+        pointCount = available;
+    }
+    if (pointCount == 0)
+        return false;
+    vertexData = data + dataOffset;
+
+    origin = glm::dvec3(readValue(vertexData, positionProperties[0]), readValue(vertexData, positionProperties[1]),
+                        readValue(vertexData, positionProperties[2]));
+    return true;
+}
+
+void PlyPointReader::start(size_t chunkPoints) {
+    if (!vertexData || worker.joinable())
+        return;
+    worker = std::thread(&PlyPointReader::decodeLoop, this, std::max<size_t>(chunkPoints, 1));
+}
+
+void PlyPointReader::decodeLoop(size_t chunkPoints) {
+    for (size_t first = 0; first < pointCount; first += chunkPoints) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            spaceAvailable.wait(lock, [this] { return stopping.load() || ready.size() < kMaxQueuedChunks; });
+        }
+        if (stopping.load())
+            return;
+
+        PlyPointChunk chunk;
+        size_t count = std::min(chunkPoints, pointCount - first);
+        decode(first, count, chunk);
+        decodedPoints.fetch_add(count, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(std::move(chunk));
+    }
+}
+
+double PlyPointReader::readValue(const char* record, const Property& property) {
+    const char* p = record + property.offset;
+    switch (property.type) {
+    case PropertyType::Int8: return readRaw<int8_t>(p);
+    case PropertyType::UInt8: return readRaw<uint8_t>(p);
+    case PropertyType::Int16: return readRaw<int16_t>(p);
+    case PropertyType::UInt16: return readRaw<uint16_t>(p);
+    case PropertyType::Int32: return readRaw<int32_t>(p);
+    case PropertyType::UInt32: return readRaw<uint32_t>(p);
+    case PropertyType::Float32: return readRaw<float>(p);
+    case PropertyType::Float64: return readRaw<double>(p);
+    default: return 0.0;
+    }
+}
+
+void PlyPointReader::decode(size_t first, size_t count, PlyPointChunk& chunk) const {
+    // 8-bit channels pass through, 16-bit ones keep their high byte, floats are in [0, 1]
+    auto channel = [](const char* record, const Property& property) -> uint8_t {
+        switch (property.type) {
+        case PropertyType::UInt8: return readRaw<uint8_t>(record + property.offset);
+        case PropertyType::UInt16: return static_cast<uint8_t>(readRaw<uint16_t>(record + property.offset) >> 8);
+        case PropertyType::Float32:
+        case PropertyType::Float64: return static_cast<uint8_t>(std::clamp(readValue(record, property), 0.0, 1.0) * 255.0 + 0.5);
+        default: return static_cast<uint8_t>(std::clamp(readValue(record, property), 0.0, 255.0));
+        }
+    };
+
+    chunk.first = first;
+    chunk.points.resize(count);
+    chunk.bounds = BoundingBox();
+    std::mutex boundsMutex;
+    bool color = hasColor();
+    parallelFor(count, 1 << 16, [&](size_t begin, size_t end) {
+        BoundingBox local;
+        for (size_t i = begin; i < end; ++i) {
+            const char* record = vertexData + (first + i) * vertexStride;
+            PointVertex& point = chunk.points[i];
+            // Subtracting in double keeps precision for coordinates far from zero
+            point.position = glm::vec3(readValue(record, positionProperties[0]) - origin.x,
+                                       readValue(record, positionProperties[1]) - origin.y,
+                                       readValue(record, positionProperties[2]) - origin.z);
+            if (color)
+                point.color = packColor(channel(record, colorProperties[0]), channel(record, colorProperties[1]),
+                                        channel(record, colorProperties[2]));
+            expandBounds(local, point.position);
+        }
+        std::lock_guard<std::mutex> lock(boundsMutex);
+        expandBounds(chunk.bounds, local);
+    });
+}
+
+bool PlyPointReader::poll(PlyPointChunk& chunk) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ready.empty())
+            return false;
+        chunk = std::move(ready.front());
+        ready.pop_front();
+    }
+    spaceAvailable.notify_one();
+    handedOut += chunk.points.size();
+    return true;
+}
+
+bool PlyPointReader::isFinished() const {
+    return vertexData && handedOut >= pointCount;
+}
+
+void PlyPointReader::close() {
+    // Under the lock, so the decoder cannot test the predicate, miss the store and then sleep
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping.store(true);
+    }
+    spaceAvailable.notify_all();
+    if (worker.joinable())
+        worker.join();
+    stopping.store(false);
+
+    ready.clear();
+    file.close();
+    vertexData = nullptr;
+    vertexStride = 0;
+    pointCount = 0;
+    for (int i = 0; i < 3; ++i)
+        positionProperties[i] = colorProperties[i] = Property();
+    origin = glm::dvec3(0.0);
+    decodedPoints.store(0);
+    handedOut = 0;
+}
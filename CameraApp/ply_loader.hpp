@@ -0,0 +1,95 @@
+//
+//  ply_loader.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/19/25.
+//
+
+#ifndef ply_loader_hpp
+#define ply_loader_hpp
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "point_cloud.hpp"
+#include "mapped_file.hpp"
+
+// A run of decoded points, consecutive in the file
+struct PlyPointChunk {
+    size_t first = 0;                // index of the first point in the file
+    std::vector<PointVertex> points;
+    BoundingBox bounds;              // relative to the reader's origin
+};
+
+// Streaming reader for binary little-endian PLY point clouds. open() maps the file and parses
+// the header; start() decodes the "vertex" element on a background thread, chunk by chunk with
+// the worker threads splitting each chunk, and poll() hands finished chunks to the render
+// thread in file order. At most kMaxQueuedChunks wait at a time, so memory stays bounded
+// however large the file is. Reads x/y/z (float or double) and optional red/green/blue (any
+// integer or float type); other properties and elements are skipped. Positions are stored
+// relative to the first point, which keeps float precision for georeferenced scans.
+class PlyPointReader {
+public:
+    static constexpr size_t kDefaultChunkPoints = size_t(1) << 20;
+    static constexpr size_t kMaxQueuedChunks = 4;
+
+    PlyPointReader() = default;
+    ~PlyPointReader() { close(); }
+    PlyPointReader(const PlyPointReader&) = delete;
+    PlyPointReader& operator=(const PlyPointReader&) = delete;
+
+    // Reports errors on std::cerr
+    bool open(const std::string& path);
+    void start(size_t chunkPoints = kDefaultChunkPoints);
+    // Never blocks; false when no chunk is ready yet
+    bool poll(PlyPointChunk& chunk);
+    // Every chunk has been handed out
+    bool isFinished() const;
+    // Stops the decoder and unmaps the file
+    void close();
+
+    size_t getPointCount() const { return pointCount; }
+    size_t getDecodedPoints() const { return decodedPoints.load(std::memory_order_relaxed); }
+    bool hasColor() const { return colorProperties[0].type != PropertyType::None; }
+    // World position of the points' local origin
+    const glm::dvec3& getOrigin() const { return origin; }
+
+private:
+    enum class PropertyType { None, Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+    struct Property {
+        PropertyType type = PropertyType::None;
+        size_t offset = 0;   // bytes into the vertex record
+    };
+
+    static double readValue(const char* record, const Property& property);
+    bool parseHeader(const std::string& path);
+    void decodeLoop(size_t chunkPoints);
+    void decode(size_t first, size_t count, PlyPointChunk& chunk) const;
+
+    MappedFile file;
+    const char* vertexData = nullptr;
+    size_t vertexStride = 0;
+    size_t pointCount = 0;
+    Property positionProperties[3];
+    Property colorProperties[3];
+    glm::dvec3 origin = glm::dvec3(0.0);
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable spaceAvailable;
+    std::deque<PlyPointChunk> ready;
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> decodedPoints{0};
+    size_t handedOut = 0;   // render thread only
+};
+
+#endif /* ply_loader_hpp */
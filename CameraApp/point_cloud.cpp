@@ -0,0 +1,138 @@
+//
+//  point_cloud.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/19/25.
+//
+
+#include "point_cloud.hpp"
+#include "shader_utils.hpp"
+#include "object_constants.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+namespace {
+
+// uPointScale is the diameter in pixels of a point one unit from the eye (perspective) or at
+// any depth (orthographic); the fragment shader rounds the square sprite off
+const char* kVertexShaderSource = R"(
+    #version 330 core
+    layout(location = 0) in vec3 aPos;
+    layout(location = 1) in vec4 aColor;
+    layout(std140) uniform ObjectBlock {
+        mat4 uModelViewProjection;
+        mat4 uModelView;
+        uvec4 uObject;
+    };
+    uniform float uPointScale;
+    uniform bool uPerspective;
+    out vec3 vColor;
+
+    void main() {
+        vec4 position = vec4(aPos, 1.0);
+        float distance = uPerspective ? max(-(uModelView * position).z, 1e-4) : 1.0;
+        gl_PointSize = clamp(uPointScale / distance, 1.0, 64.0);
+        vColor = aColor.rgb;
+        gl_Position = uModelViewProjection * position;
+    }
+)";
+
+const char* kFragmentShaderSource = R"(
+    #version 330 core
+    in vec3 vColor;
+    out vec4 FragColor;
+
+    void main() {
+        vec2 offset = gl_PointCoord - vec2(0.5);
+        if (dot(offset, offset) > 0.25)
+            discard;
+        FragColor = vec4(vColor, 1.0);
+    }
+)";
+
+}
+
+bool PointCloud::init(size_t points) {
+    program = buildProgram(kVertexShaderSource, nullptr, kFragmentShaderSource);
+    if (!program)
+        return false;
+    ObjectConstantsRing::bindUniformBlock(program);
+    pointScaleLoc = glGetUniformLocation(program, "uPointScale");
+    perspectiveLoc = glGetUniformLocation(program, "uPerspective");
+
+    capacity = points;
+    pointCount = 0;
+    bounds = BoundingBox();
+
+    // Errors left over from earlier calls would read as a failed allocation
+    while (glGetError() != GL_NO_ERROR) {}
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(PointVertex), nullptr, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PointVertex), (void*)offsetof(PointVertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PointVertex), (void*)offsetof(PointVertex, color));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // 100M points is 1.6 GB, which not every driver will hand out
+    if (glGetError() != GL_NO_ERROR) {
+        std::cerr << "Could not allocate " << capacity * sizeof(PointVertex) / (1024 * 1024) << " MB for " << capacity << " points\n";
+        cleanup();
+        return false;
+    }
+    return true;
+}
+
+void PointCloud::cleanup() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteProgram(program);
+    VAO = VBO = program = 0;
+    capacity = pointCount = 0;
+}
+
+bool PointCloud::append(const std::vector<PointVertex>& points, const BoundingBox& pointBounds) {
+    if (points.size() > capacity - pointCount)
+        return false;
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, pointCount * sizeof(PointVertex), points.size() * sizeof(PointVertex), points.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    pointCount += points.size();
+    expandBounds(bounds, pointBounds);
+    return true;
+}
+
+void PointCloud::draw(const Camera& camera, float pointSize, double modelScale) const {
+    if (pointCount == 0)
+        return;
+
+    // getPixelsPerUnit(1) is the perspective scale at unit distance, and the whole scale when orthographic
+    bool perspective = camera.getProjectionType() != Camera::ProjectionType::Orthographic;
+    double pointScale = pointSize * modelScale * camera.getPixelsPerUnit(1.0);
+
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glUseProgram(program);
+    glUniform1f(pointScaleLoc, static_cast<float>(pointScale));
+    glUniform1i(perspectiveLoc, perspective ? 1 : 0);
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(pointCount));
+    glBindVertexArray(0);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+}
+
+float PointCloud::getSuggestedPointSize() const {
+    if (pointCount == 0 || bounds.isEmpty())
+        return 0.0f;
+    // Scans sample surfaces, so the spacing goes with the square root of the density
+    glm::vec3 size = bounds.max - bounds.min;
+    float area = 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    return std::sqrt(area / static_cast<float>(pointCount));
+}
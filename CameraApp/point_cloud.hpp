@@ -0,0 +1,65 @@
+//
+//  point_cloud.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/19/25.
+//
+
+#ifndef point_cloud_hpp
+#define point_cloud_hpp
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "camera.hpp"
+#include "bounds.hpp"
+
+// 16 bytes per point: position relative to the cloud's origin, RGBA8 color (red in the low byte)
+struct PointVertex {
+    glm::vec3 position;
+    uint32_t color = 0xffffffffu;
+};
+
+inline uint32_t packColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
+    return uint32_t(r) | (uint32_t(g) << 8) | (uint32_t(b) << 16) | (uint32_t(a) << 24);
+}
+
+// Unindexed points drawn with GL_POINTS, the counterpart of Mesh for scans. Storage for the
+// whole cloud is allocated up front and filled in arrival order, so whatever has been appended
+// so far is drawable while the rest is still loading.
+class PointCloud {
+public:
+    // Builds the point program and allocates room for capacity points
+    bool init(size_t capacity);
+    void cleanup();
+
+    // Uploads points after the ones already present; false when they do not fit
+    bool append(const std::vector<PointVertex>& points, const BoundingBox& pointBounds);
+
+    // Transform comes from the bound ObjectBlock. pointSize is the world-space diameter of a
+    // point; the Camera projection turns it into pixels, shrinking with distance in perspective
+    // views. modelScale is the model matrix's scale, so sizes follow the object.
+    void draw(const Camera& camera, float pointSize, double modelScale) const;
+
+    size_t getPointCount() const { return pointCount; }
+    size_t getCapacity() const { return capacity; }
+    // Bounds of the uploaded points, relative to the origin of the source
+    const BoundingBox& getBounds() const { return bounds; }
+    // World-space diameter that roughly closes the gaps of a scanned surface
+    float getSuggestedPointSize() const;
+
+private:
+    GLuint VAO = 0, VBO = 0;
+    GLuint program = 0;
+    GLint pointScaleLoc = -1, perspectiveLoc = -1;
+    size_t capacity = 0;
+    size_t pointCount = 0;
+    BoundingBox bounds;
+};
+
+#endif /* point_cloud_hpp */
@@ -0,0 +1,34 @@
+//
+//  render_target.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 6/9/25.
+//
+
+#ifndef render_target_hpp
+#define render_target_hpp
+
+#pragma once
+
+#include <GL/glew.h>
+
+// Offscreen color + 32-bit float depth framebuffer, resolved to the window with a blit
+class RenderTarget {
+public:
+    bool init(int width, int height);
+    void resize(int width, int height);
+    void bind() const;
+    void blitToScreen() const;
+    void cleanup();
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    GLuint FBO = 0, colorRBO = 0, depthRBO = 0;
+    int width = 0, height = 0;
+
+    bool allocate();
+};
+
+#endif /* render_target_hpp */
@@ -0,0 +1,122 @@
+//
+//  stream_buffer.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/21/25.
+//
+
+#include "stream_buffer.hpp"
+
+#include <cstring>
+#include <iostream>
+
+bool StreamBuffer::init(GLenum bufferTarget, size_t size, int frames) {
+    target = bufferTarget;
+    frameSize = size;
+    frameCount = frames;
+    frame = 0;
+    head = flushedHead = 0;
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+
+    persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    if (persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, frameSize * frameCount, nullptr, flags);
+        mapped = static_cast<unsigned char*>(glMapBufferRange(target, 0, frameSize * frameCount, flags));
+        if (!mapped) {
+            // Storage is immutable now, start over with a new name for the fallback
+            std::cerr << "Persistent mapping failed, streaming through buffer orphaning\n";
+            glBindBuffer(target, 0);
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(target, buffer);
+            persistent = false;
+        }
+    }
+
+    if (persistent) {
+        fences.assign(frameCount, nullptr);
+    } else {
+        glBufferData(target, frameSize, nullptr, GL_STREAM_DRAW);
+        staging.resize(frameSize);
+    }
+
+    glBindBuffer(target, 0);
+    return buffer != 0;
+}
+
+void StreamBuffer::cleanup() {
+    for (GLsync& fence : fences) {
+        if (fence)
+            glDeleteSync(fence);
+    }
+    fences.clear();
+
+    if (mapped) {
+        glBindBuffer(target, buffer);
+        glUnmapBuffer(target);
+        glBindBuffer(target, 0);
+        mapped = nullptr;
+    }
+
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    staging.clear();
+}
+
+void StreamBuffer::beginFrame() {
+    head = flushedHead = 0;
+    if (!persistent || !fences[frame])
+        return;
+
+    // Only blocks when the GPU is more than frameCount frames behind
+    GLbitfield flags = 0;
+    while (true) {
+        GLenum status = glClientWaitSync(fences[frame], flags, 1000000);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED)
+            break;
+        flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    }
+    glDeleteSync(fences[frame]);
+    fences[frame] = nullptr;
+}
+
+StreamAllocation StreamBuffer::allocate(size_t size, size_t alignment) {
+    size_t offset = (head + alignment - 1) / alignment * alignment;
+    if (offset + size > frameSize) {
+        if (!overflowReported)
+            std::cerr << "Stream buffer frame region of " << frameSize << " bytes is full\n";
+        overflowReported = true;
+        return StreamAllocation();
+    }
+    head = offset + size;
+
+    StreamAllocation allocation;
+    allocation.offset = static_cast<GLintptr>(regionBase() + offset);
+    allocation.data = persistent ? mapped + regionBase() + offset : staging.data() + offset;
+    return allocation;
+}
+
+void StreamBuffer::flush() {
+    // Coherent mapping: writes are already visible to commands issued after them
+    if (persistent || head == flushedHead)
+        return;
+
+    // Orphan so draws already queued keep the old storage, then upload the whole frame so
+    // far; earlier allocations of this frame stay valid for later draws
+    glBindBuffer(target, buffer);
+    glBufferData(target, frameSize, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(target, 0, head, staging.data());
+    glBindBuffer(target, 0);
+    flushedHead = head;
+}
+
+void StreamBuffer::endFrame() {
+    flush();
+    if (persistent) {
+        fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frame = (frame + 1) % frameCount;
+    }
+}
@@ -0,0 +1,66 @@
+//
+//  stream_buffer.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/21/25.
+//
+
+#ifndef stream_buffer_hpp
+#define stream_buffer_hpp
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+struct StreamAllocation {
+    void* data = nullptr;   // write-only CPU pointer, valid until flush()
+    GLintptr offset = 0;    // byte offset inside getBuffer()
+    bool isValid() const { return data != nullptr; }
+};
+
+// Ring buffer for data rewritten every frame. With GL 4.4 / ARB_buffer_storage it is one
+// persistently mapped, coherent buffer split into per-frame regions, each guarded by a fence
+// so the CPU never overwrites a region the GPU may still read. Without it, writes go to a
+// CPU staging area that flush() uploads into a freshly orphaned buffer.
+class StreamBuffer {
+public:
+    static constexpr int kDefaultFrameCount = 3;
+
+    bool init(GLenum target, size_t frameSize, int frameCount = kDefaultFrameCount);
+    void cleanup();
+
+    // Waits (normally not at all) until the GPU has released this frame's region
+    void beginFrame();
+    // Returns an invalid allocation when the frame's region is exhausted
+    StreamAllocation allocate(size_t size, size_t alignment = 16);
+    // Makes everything allocated so far visible to the GPU; call before drawing with it
+    void flush();
+    void endFrame();
+
+    GLuint getBuffer() const { return buffer; }
+    bool isPersistent() const { return persistent; }
+    size_t getFrameSize() const { return frameSize; }
+    size_t getUsed() const { return head; }
+
+private:
+    GLenum target = GL_ARRAY_BUFFER;
+    GLuint buffer = 0;
+    bool persistent = false;
+    size_t frameSize = 0;
+    int frameCount = 0;
+    int frame = 0;
+
+    size_t head = 0;          // bytes used in the current frame
+    size_t flushedHead = 0;
+
+    unsigned char* mapped = nullptr;          // persistent path
+    std::vector<GLsync> fences;
+    std::vector<unsigned char> staging;       // orphaning path
+    bool overflowReported = false;
+
+    size_t regionBase() const { return persistent ? static_cast<size_t>(frame) * frameSize : 0; }
+};
+
+#endif /* stream_buffer_hpp */
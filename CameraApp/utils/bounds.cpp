@@ -0,0 +1,29 @@
+//
+//  bounds.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 6/2/25.
+//
+
+#include "bounds.hpp"
+#include <cmath>
+
+BoundingBox transformBounds(const BoundingBox& box, const glm::mat4& transform) {
+    if (box.isEmpty())
+        return box;
+
+    // Arvo's method: transform the center, then project the extent onto each axis
+    glm::vec3 center = glm::vec3(transform * glm::vec4(box.center(), 1.0f));
+    glm::vec3 extent = box.extent();
+    glm::vec3 newExtent(0.0f);
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int k = 0; k < 3; ++k) {
+            newExtent[axis] += std::abs(transform[k][axis]) * extent[k];
+        }
+    }
+
+    BoundingBox result;
+    result.min = center - newExtent;
+    result.max = center + newExtent;
+    return result;
+}
@@ -0,0 +1,36 @@
+//
+//  bounds.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 6/2/25.
+//
+
+#ifndef bounds_hpp
+#define bounds_hpp
+
+#include <glm/glm.hpp>
+#include <limits>
+
+struct BoundingBox {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extent() const { return (max - min) * 0.5f; }
+};
+
+// Inline: these sit in the inner loops of the BVH builder and the loaders
+inline void expandBounds(BoundingBox& box, const glm::vec3& point) {
+    box.min = glm::min(box.min, point);
+    box.max = glm::max(box.max, point);
+}
+
+inline void expandBounds(BoundingBox& box, const BoundingBox& other) {
+    box.min = glm::min(box.min, other.min);
+    box.max = glm::max(box.max, other.max);
+}
+
+BoundingBox transformBounds(const BoundingBox& box, const glm::mat4& transform);
+
+#endif /* bounds_hpp */
@@ -0,0 +1,296 @@
+//
+//  json.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/15/25.
+//
+
+#include "json.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const JsonValue kNull;
+
+// Deep enough for any asset header, shallow enough for the call stack
+constexpr int kMaxDepth = 256;
+
+}
+
+long long JsonValue::asIndex(long long fallback) const {
+    if (type != Type::Number || number < 0.0 || number > 9.0e15 || std::floor(number) != number)
+        return fallback;
+    return static_cast<long long>(number);
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+    return type == Type::Array && index < items.size() ? items[index] : kNull;
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const {
+    if (type != Type::Object)
+        return kNull;
+    for (const auto& member : members) {
+        if (member.first == key)
+            return member.second;
+    }
+    return kNull;
+}
+
+class JsonParser {
+public:
+    JsonParser(const char* text, size_t length) : p(text), begin(text), end(text + length) {}
+
+    bool parse(JsonValue& root, std::string& error) {
+        skipSpace();
+        if (!parseValue(root, 0)) {
+            error = message + " at byte " + std::to_string(p - begin);
+            return false;
+        }
+        skipSpace();
+        if (p != end) {
+            error = "trailing characters at byte " + std::to_string(p - begin);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const char* p;
+    const char* begin;
+    const char* end;
+    std::string message;
+
+    bool fail(const char* what) {
+        message = what;
+        return false;
+    }
+
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            ++p;
+    }
+
+    bool literal(const char* word) {
+        size_t length = std::strlen(word);
+        if (static_cast<size_t>(end - p) < length || std::memcmp(p, word, length) != 0)
+            return fail("invalid literal");
+        p += length;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth) {
+        if (depth > kMaxDepth)
+            return fail("nesting too deep");
+        if (p >= end)
+            return fail("unexpected end");
+
+        switch (*p) {
+        case '{':
+            return parseObject(value, depth);
+        case '[':
+            return parseArray(value, depth);
+        case '"':
+            value.type = JsonValue::Type::String;
+            return parseString(value.string);
+        case 't':
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+            return literal("true");
+        case 'f':
+            value.type = JsonValue::Type::Bool;
+            value.boolean = false;
+            return literal("false");
+        case 'n':
+            value.type = JsonValue::Type::Null;
+            return literal("null");
+        default:
+            return parseNumber(value);
+        }
+    }
+
+    bool parseObject(JsonValue& value, int depth) {
+        value.type = JsonValue::Type::Object;
+        ++p;
+        skipSpace();
+        if (p < end && *p == '}') {
+            ++p;
+            return true;
+        }
+        while (true) {
+            skipSpace();
+            if (p >= end || *p != '"')
+                return fail("expected member name");
+            value.members.emplace_back();
+            if (!parseString(value.members.back().first))
+                return false;
+            skipSpace();
+            if (p >= end || *p != ':')
+                return fail("expected ':'");
+            ++p;
+            skipSpace();
+            if (!parseValue(value.members.back().second, depth + 1))
+                return false;
+            skipSpace();
+            if (p < end && *p == ',') {
+                ++p;
+                continue;
+            }
+            if (p < end && *p == '}') {
+                ++p;
+                return true;
+            }
+            return fail("expected ',' or '}'");
+        }
+    }
+
+    bool parseArray(JsonValue& value, int depth) {
+        value.type = JsonValue::Type::Array;
+        ++p;
+        skipSpace();
+        if (p < end && *p == ']') {
+            ++p;
+            return true;
+        }
+        while (true) {
+            skipSpace();
+            value.items.emplace_back();
+            if (!parseValue(value.items.back(), depth + 1))
+                return false;
+            skipSpace();
+            if (p < end && *p == ',') {
+                ++p;
+                continue;
+            }
+            if (p < end && *p == ']') {
+                ++p;
+                return true;
+            }
+            return fail("expected ',' or ']'");
+        }
+    }
+
+    bool parseHex4(unsigned& code) {
+        if (end - p < 4)
+            return fail("truncated \\u escape");
+        code = 0;
+        for (int i = 0; i < 4; ++i, ++p) {
+            char c = *p;
+            code <<= 4;
+            if (c >= '0' && c <= '9')
+                code |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                code |= c - 'A' + 10;
+            else
+                return fail("invalid \\u escape");
+        }
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, unsigned code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xc0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xe0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        } else {
+            out += static_cast<char>(0xf0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    bool parseString(std::string& out) {
+        ++p;
+        while (true) {
+            // Copy unescaped runs in one go
+            const char* run = p;
+            while (p < end && *p != '"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20)
+                ++p;
+            out.append(run, p - run);
+            if (p >= end)
+                return fail("unterminated string");
+            if (*p == '"') {
+                ++p;
+                return true;
+            }
+            if (*p != '\\')
+                return fail("control character in string");
+
+            if (++p >= end)
+                return fail("unterminated string");
+            char escape = *p++;
+            switch (escape) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                unsigned code;
+                if (!parseHex4(code))
+                    return false;
+                // A high surrogate needs its low half
+                if (code >= 0xd800 && code < 0xdc00) {
+                    unsigned low;
+                    if (end - p < 2 || p[0] != '\\' || p[1] != 'u')
+                        return fail("unpaired surrogate");
+                    p += 2;
+                    if (!parseHex4(low))
+                        return false;
+                    if (low < 0xdc00 || low >= 0xe000)
+                        return fail("unpaired surrogate");
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default:
+                return fail("invalid escape");
+            }
+        }
+    }
+
+    bool parseNumber(JsonValue& value) {
+        const char* start = p;
+        if (p < end && *p == '-')
+            ++p;
+        if (p >= end || !(*p >= '0' && *p <= '9'))
+            return fail("unexpected character");
+        while (p < end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-'))
+            ++p;
+
+        // The text is not null-terminated, strtod gets a bounded copy
+        char buffer[64];
+        size_t length = static_cast<size_t>(p - start);
+        if (length >= sizeof(buffer))
+            return fail("number too long");
+        std::memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        char* parsedEnd = nullptr;
+        value.number = std::strtod(buffer, &parsedEnd);
+        if (parsedEnd != buffer + length)
+            return fail("invalid number");
+        value.type = JsonValue::Type::Number;
+        return true;
+    }
+};
+
+bool parseJson(const char* text, size_t length, JsonValue& root, std::string& error) {
+    root = JsonValue();
+    JsonParser parser(text, length);
+    return parser.parse(root, error);
+}
@@ -0,0 +1,59 @@
+//
+//  json.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/15/25.
+//
+
+#ifndef json_hpp
+#define json_hpp
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal JSON document for asset headers (glTF): the whole tree is parsed up front, lookups
+// of missing keys or indices return a shared null value so chains never need checks.
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type getType() const { return type; }
+    bool isNull() const { return type == Type::Null; }
+    bool isNumber() const { return type == Type::Number; }
+    bool isString() const { return type == Type::String; }
+    bool isArray() const { return type == Type::Array; }
+    bool isObject() const { return type == Type::Object; }
+
+    bool asBool(bool fallback = false) const { return type == Type::Bool ? boolean : fallback; }
+    double asNumber(double fallback = 0.0) const { return type == Type::Number ? number : fallback; }
+    // Non-negative integers only, anything else yields the fallback
+    long long asIndex(long long fallback = -1) const;
+    const std::string& asString() const { return string; }
+
+    // Array length or member count
+    size_t size() const { return type == Type::Object ? members.size() : items.size(); }
+    const JsonValue& operator[](size_t index) const;
+    // Keeps literal indices such as [0] from being read as a null key
+    const JsonValue& operator[](int index) const { return (*this)[static_cast<size_t>(index)]; }
+    const JsonValue& operator[](const char* key) const;
+    bool has(const char* key) const { return !(*this)[key].isNull(); }
+    const std::vector<std::pair<std::string, JsonValue>>& getMembers() const { return members; }
+
+private:
+    friend class JsonParser;
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+};
+
+// Parses RFC 8259 JSON (no comments or trailing commas). On failure returns false with a
+// message that includes the byte offset.
+bool parseJson(const char* text, size_t length, JsonValue& root, std::string& error);
+
+#endif /* json_hpp */
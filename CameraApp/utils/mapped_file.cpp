@@ -0,0 +1,71 @@
+//
+//  mapped_file.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/12/25.
+//
+
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+
+bool MappedFile::open(const std::string& path, Access access) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        std::cerr << "Failed to stat " << path << ": " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return false;
+    }
+
+    length = static_cast<size_t>(info.st_size);
+    if (length > 0) {
+        void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            std::cerr << "Failed to map " << path << ": " << std::strerror(errno) << "\n";
+            ::close(fd);
+            length = 0;
+            return false;
+        }
+        mapping = static_cast<const char*>(address);
+        madvise(address, length, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    }
+
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    opened = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapping)
+        munmap(const_cast<char*>(mapping), length);
+    mapping = nullptr;
+    length = 0;
+    opened = false;
+}
+
+void MappedFile::release(size_t offset, size_t size) const {
+    if (!mapping || offset >= length)
+        return;
+    // madvise works on whole pages: round inwards so neighbouring data stays mapped
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = (offset + page - 1) / page * page;
+    size_t end = std::min(offset + size, length) / page * page;
+    if (begin < end)
+        madvise(const_cast<char*>(mapping) + begin, end - begin, MADV_DONTNEED);
+}
@@ -0,0 +1,46 @@
+//
+//  mapped_file.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/12/25.
+//
+
+#ifndef mapped_file_hpp
+#define mapped_file_hpp
+
+#include <cstddef>
+#include <string>
+
+// Read-only mapping of a whole file (POSIX mmap). Pages are read in by the OS on first touch,
+// so any number of threads can parse different parts of the file without copying it.
+class MappedFile {
+public:
+    enum class Access {
+        Sequential,   // read ahead aggressively, e.g. a parser walking the file once
+        Random        // no read-ahead, e.g. chunks fetched on demand
+    };
+
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, Access access = Access::Sequential);
+    void close();
+
+    // Drops this process's pages of [offset, offset + size) once their data has been copied out,
+    // so streaming through a large file does not grow the resident set; later reads fault them back
+    void release(size_t offset, size_t size) const;
+
+    bool isOpen() const { return opened; }
+    // nullptr for an empty file
+    const char* data() const { return mapping; }
+    size_t size() const { return length; }
+
+private:
+    const char* mapping = nullptr;
+    size_t length = 0;
+    bool opened = false;
+};
+
+#endif /* mapped_file_hpp */
@@ -0,0 +1,306 @@
+//
+//  mesh_optimizer.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/1/25.
+//
+
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Vertex -> triangles adjacency in CSR form
+struct Adjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    Adjacency(const std::vector<uint32_t>& indices, size_t vertexCount) : offsets(vertexCount + 1, 0), triangles(indices.size()) {
+        for (uint32_t index : indices)
+            ++offsets[index + 1];
+        for (size_t v = 0; v < vertexCount; ++v)
+            offsets[v + 1] += offsets[v];
+
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i)
+            triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    uint32_t count(uint32_t vertex) const { return offsets[vertex + 1] - offsets[vertex]; }
+};
+
+// FIFO cache with timestamps: a vertex is cached while fewer than cacheSize misses happened since
+class FifoCache {
+public:
+    FifoCache(size_t vertexCount, unsigned size) : stamps(vertexCount, 0), cacheSize(size), time(size + 1) {}
+
+    bool access(uint32_t vertex) {
+        if (time - stamps[vertex] <= cacheSize)
+            return true;
+        stamps[vertex] = time++;
+        return false;
+    }
+
+    void flush() { time += cacheSize + 1; }
+
+private:
+    std::vector<uint32_t> stamps;
+    unsigned cacheSize;
+    uint32_t time;
+};
+
+// Directions toward the viewer used to rank clusters: the 6 axes and 8 diagonals
+std::vector<glm::vec3> viewDirections() {
+    std::vector<glm::vec3> directions;
+    for (int axis = 0; axis < 3; ++axis) {
+        for (float sign : { 1.0f, -1.0f }) {
+            glm::vec3 direction(0.0f);
+            direction[axis] = sign;
+            directions.push_back(direction);
+        }
+    }
+    for (int corner = 0; corner < 8; ++corner)
+        directions.push_back(glm::normalize(glm::vec3(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f)));
+    return directions;
+}
+
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize) {
+    VertexCacheStats stats;
+    if (indices.empty())
+        return stats;
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0, unique = 0;
+    for (uint32_t index : indices) {
+        if (!cache.access(index))
+            ++misses;
+        if (!used[index]) {
+            used[index] = true;
+            ++unique;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / unique;
+    return stats;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>* clusterStarts, unsigned cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (clusterStarts)
+        clusterStarts->clear();
+    if (triangleCount == 0)
+        return;
+
+    Adjacency adjacency(indices, vertexCount);
+
+    std::vector<uint32_t> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        live[v] = adjacency.count(static_cast<uint32_t>(v));
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;
+    bool coldStart = true;
+
+    // Start at the first referenced vertex
+    int64_t fan = -1;
+    while (cursor < vertexCount && live[cursor] == 0)
+        ++cursor;
+    if (cursor < vertexCount)
+        fan = static_cast<int64_t>(cursor);
+
+    while (fan >= 0) {
+        if (coldStart && clusterStarts)
+            clusterStarts->push_back(static_cast<uint32_t>(result.size() / 3));
+        coldStart = false;
+
+        candidates.clear();
+        uint32_t vertex = static_cast<uint32_t>(fan);
+        for (uint32_t a = adjacency.offsets[vertex]; a < adjacency.offsets[vertex + 1]; ++a) {
+            uint32_t triangle = adjacency.triangles[a];
+            if (emitted[triangle])
+                continue;
+            emitted[triangle] = true;
+
+            for (int k = 0; k < 3; ++k) {
+                uint32_t v = indices[triangle * 3 + k];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - cacheTime[v] > cacheSize)
+                    cacheTime[v] = time++;
+            }
+        }
+
+        // Next fan: a candidate still in cache after emitting all its remaining triangles
+        fan = -1;
+        uint32_t bestPriority = 0;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0)
+                continue;
+            uint32_t priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+                priority = time - cacheTime[v];
+            if (fan < 0 || priority > bestPriority) {
+                bestPriority = priority;
+                fan = v;
+            }
+        }
+
+        if (fan >= 0)
+            continue;
+
+        // Dead end: back up through recently used vertices, then scan forward
+        while (!deadEnd.empty()) {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) {
+                fan = v;
+                break;
+            }
+        }
+        if (fan < 0) {
+            while (cursor < vertexCount && live[cursor] == 0)
+                ++cursor;
+            if (cursor < vertexCount) {
+                fan = static_cast<int64_t>(cursor);
+                coldStart = true;
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const glm::vec3* positions, size_t positionStride,
+                      size_t vertexCount, const std::vector<uint32_t>& clusterStarts, float threshold, unsigned cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    auto position = [&](uint32_t vertex) -> const glm::vec3& {
+        return *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const unsigned char*>(positions) + vertex * positionStride);
+    };
+
+    // Soft boundaries: inside each cold-start cluster, cut wherever the running ACMR has
+    // dropped to threshold x the whole cluster's, the triangles so far reuse the cache well
+    std::vector<uint32_t> hard = clusterStarts;
+    if (hard.empty() || hard[0] != 0)
+        hard.insert(hard.begin(), 0);
+    hard.push_back(static_cast<uint32_t>(triangleCount));
+
+    std::vector<uint32_t> clusters;
+    for (size_t c = 0; c + 1 < hard.size(); ++c) {
+        uint32_t begin = hard[c], end = hard[c + 1];
+        if (begin >= end)
+            continue;
+
+        FifoCache cache(vertexCount, cacheSize);
+        size_t clusterMisses = 0;
+        for (uint32_t t = begin; t < end; ++t)
+            for (int k = 0; k < 3; ++k)
+                clusterMisses += !cache.access(indices[t * 3 + k]);
+        float clusterThreshold = threshold * static_cast<float>(clusterMisses) / (end - begin);
+
+        cache.flush();
+        clusters.push_back(begin);
+        size_t misses = 0;
+        uint32_t start = begin;
+        for (uint32_t t = begin; t < end; ++t) {
+            for (int k = 0; k < 3; ++k)
+                misses += !cache.access(indices[t * 3 + k]);
+            if (t + 1 < end && static_cast<float>(misses) / (t + 1 - start) <= clusterThreshold) {
+                clusters.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                cache.flush();
+            }
+        }
+    }
+    clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+    // Area-weighted centroid and normal per cluster
+    size_t clusterCount = clusters.size() - 1;
+    std::vector<glm::vec3> centroids(clusterCount), normals(clusterCount);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; ++c) {
+        glm::vec3 weighted(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            const glm::vec3& a = position(indices[t * 3]);
+            const glm::vec3& b = position(indices[t * 3 + 1]);
+            const glm::vec3& d = position(indices[t * 3 + 2]);
+            glm::vec3 cross = glm::cross(b - a, d - a);
+            float triangleArea = glm::length(cross);
+            weighted += (a + b + d) * (triangleArea / 3.0f);
+            normal += cross;
+            area += triangleArea;
+        }
+        centroids[c] = area > 0.0f ? weighted / area : position(indices[clusters[c] * 3]);
+        float normalLength = glm::length(normal);
+        normals[c] = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f);
+        meshCentroid += weighted;
+        meshArea += area;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Rank by mean depth toward every viewer the cluster faces: outer, viewer-facing
+    // clusters draw first and occlude the rest
+    std::vector<glm::vec3> directions = viewDirections();
+    std::vector<float> keys(clusterCount, -INFINITY);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float sum = 0.0f;
+        int facing = 0;
+        for (const glm::vec3& toViewer : directions) {
+            if (glm::dot(normals[c], toViewer) <= 0.0f)
+                continue;
+            sum += glm::dot(centroids[c] - meshCentroid, toViewer);
+            ++facing;
+        }
+        if (facing > 0)
+            keys[c] = sum / facing;
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+        order[c] = static_cast<uint32_t>(c);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (uint32_t c : order)
+        result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    indices.swap(result);
+}
+
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) {
+    const uint32_t kUnassigned = 0xffffffffu;
+    std::vector<uint32_t> remap(vertexCount, kUnassigned);
+
+    uint32_t next = 0;
+    for (uint32_t& index : indices) {
+        if (remap[index] == kUnassigned)
+            remap[index] = next++;
+        index = remap[index];
+    }
+    for (uint32_t& target : remap) {
+        if (target == kUnassigned)
+            target = next++;
+    }
+    return remap;
+}
@@ -0,0 +1,55 @@
+//
+//  mesh_optimizer.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/1/25.
+//
+
+#ifndef mesh_optimizer_hpp
+#define mesh_optimizer_hpp
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Load-time index and vertex reordering. Run in this order: vertex cache, overdraw (which keeps
+// most of the cache order), then vertex fetch.
+
+constexpr unsigned kVertexCacheSize = 16;
+
+struct VertexCacheStats {
+    float acmr = 0.0f;   // transformed vertices per triangle, 0.5 is ideal for large grids
+    float atvr = 0.0f;   // transformed vertices per unique vertex, 1 is ideal
+};
+
+// FIFO cache simulation of the given size
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize = kVertexCacheSize);
+
+// Tipsify (Sander et al. 2007): fans out from cached vertices, linear in the triangle count.
+// Fills clusterStarts with the first triangle of every point where the walk had to restart
+// cold, the natural boundaries for optimizeOverdraw.
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount,
+                         std::vector<uint32_t>* clusterStarts = nullptr, unsigned cacheSize = kVertexCacheSize);
+
+// Splits the cache-ordered triangles into clusters (cold restarts, plus cuts where the cluster
+// is cache-efficient enough already, up to `threshold` times the cluster ACMR) and sorts the
+// clusters so those nearest to viewers along a set of directions around the mesh come first.
+// positions is strided in bytes.
+void optimizeOverdraw(std::vector<uint32_t>& indices, const glm::vec3* positions, size_t positionStride,
+                      size_t vertexCount, const std::vector<uint32_t>& clusterStarts, float threshold = 1.05f,
+                      unsigned cacheSize = kVertexCacheSize);
+
+// Renumbers vertices in first-use order so fetches walk memory forward; unreferenced vertices
+// move to the end. Returns remap[old] = new, apply it to the vertex array with remapVertices.
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+
+template <typename T>
+void remapVertices(std::vector<T>& vertices, const std::vector<uint32_t>& remap) {
+    std::vector<T> remapped(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i)
+        remapped[remap[i]] = vertices[i];
+    vertices.swap(remapped);
+}
+
+#endif /* mesh_optimizer_hpp */
@@ -0,0 +1,322 @@
+//
+//  mesh_simplifier.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/5/25.
+//
+
+#include "mesh_simplifier.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+// Symmetric 4x4 quadric: the weighted sum of squared distances to a set of planes
+struct Quadric {
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0, c = 0.0;
+    double weight = 0.0;
+
+    // Plane dot(normal, p) + d = 0 with a unit normal
+    void addPlane(const glm::dvec3& n, double d, double w) {
+        a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+        a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+        b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+        c += w * d * d;
+        weight += w;
+    }
+
+    Quadric& operator+=(const Quadric& other) {
+        a00 += other.a00; a01 += other.a01; a02 += other.a02;
+        a11 += other.a11; a12 += other.a12; a22 += other.a22;
+        b0 += other.b0; b1 += other.b1; b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+        return *this;
+    }
+
+    // Mean squared distance to the planes, weighted by area
+    double error(const glm::dvec3& p) const {
+        if (weight <= 0.0)
+            return 0.0;
+        double value = p.x * (a00 * p.x + a01 * p.y + a02 * p.z)
+                     + p.y * (a01 * p.x + a11 * p.y + a12 * p.z)
+                     + p.z * (a02 * p.x + a12 * p.y + a22 * p.z)
+                     + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+        return std::max(value, 0.0) / weight;
+    }
+};
+
+struct Collapse {
+    uint32_t from, to;
+    double cost;   // squared error
+};
+
+// Spreads the low 10 bits so three of them interleave into a 30-bit Morton code
+uint32_t expandBits(uint32_t v) {
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+// Moving `from` onto `to` must not turn any surviving triangle around `from` over
+bool collapseFlips(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& offsets, const std::vector<uint32_t>& triangles,
+                   const std::vector<glm::dvec3>& positions, uint32_t from, uint32_t to) {
+    for (uint32_t k = offsets[from]; k < offsets[from + 1]; ++k) {
+        const uint32_t* triangle = &indices[triangles[k] * 3];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+            continue;
+
+        glm::dvec3 before[3], after[3];
+        for (int i = 0; i < 3; ++i) {
+            before[i] = positions[triangle[i]];
+            after[i] = triangle[i] == from ? positions[to] : before[i];
+        }
+        glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+        if (glm::dot(normalBefore, normalAfter) <= 0.0)
+            return true;
+    }
+    return false;
+}
+
+// Simplifies one cluster in place (cluster-local indices) and returns the largest squared error.
+// Each pass collapses the cheapest edges whose one-rings do not overlap, so a pass never has to
+// re-evaluate a collapse after a neighbour moved.
+double simplifyCluster(std::vector<uint32_t>& indices, const std::vector<glm::dvec3>& positions,
+                       const std::vector<uint8_t>& locked, size_t targetIndexCount, double maxCost) {
+    size_t vertexCount = positions.size();
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const glm::dvec3& p0 = positions[indices[i]];
+        glm::dvec3 normal = glm::cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+        double length = glm::length(normal);
+        if (length == 0.0)
+            continue;
+        normal /= length;
+        double d = -glm::dot(normal, p0);
+        for (int k = 0; k < 3; ++k)
+            quadrics[indices[i + k]].addPlane(normal, d, 0.5 * length);
+    }
+
+    double committed = 0.0;
+    std::vector<uint32_t> offsets(vertexCount + 1), triangles, cursor;
+    std::vector<uint32_t> target(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<Collapse> collapses;
+
+    while (indices.size() > targetIndexCount) {
+        // Vertex -> triangles adjacency of the current triangles
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (uint32_t index : indices)
+            ++offsets[index + 1];
+        for (size_t v = 0; v < vertexCount; ++v)
+            offsets[v + 1] += offsets[v];
+        triangles.resize(indices.size());
+        cursor.assign(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i)
+            triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+        // Interior edges are seen from both triangles, a < b keeps one copy. Edges seen from one
+        // side only have both vertices locked, so nothing is lost.
+        collapses.clear();
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (int e = 0; e < 3; ++e) {
+                uint32_t a = indices[i + e], b = indices[i + (e + 1) % 3];
+                if (a >= b || (locked[a] && locked[b]))
+                    continue;
+
+                Quadric combined = quadrics[a];
+                combined += quadrics[b];
+                Collapse collapse = { a, b, std::numeric_limits<double>::max() };
+                if (!locked[a])
+                    collapse.cost = combined.error(positions[b]);
+                if (!locked[b]) {
+                    double cost = combined.error(positions[a]);
+                    if (cost < collapse.cost)
+                        collapse = { b, a, cost };
+                }
+                if (collapse.cost <= maxCost)
+                    collapses.push_back(collapse);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        // An interior collapse removes two triangles
+        size_t budget = std::max<size_t>((indices.size() - targetIndexCount) / 6, 1);
+        size_t applied = 0;
+        std::fill(touched.begin(), touched.end(), 0);
+        std::iota(target.begin(), target.end(), 0);
+        for (const Collapse& collapse : collapses) {
+            if (applied == budget)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+            if (collapseFlips(indices, offsets, triangles, positions, collapse.from, collapse.to))
+                continue;
+
+            target[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            for (uint32_t k = offsets[collapse.from]; k < offsets[collapse.from + 1]; ++k) {
+                for (int i = 0; i < 3; ++i)
+                    touched[indices[triangles[k] * 3 + i]] = 1;
+            }
+            committed = std::max(committed, collapse.cost);
+            ++applied;
+        }
+        if (applied == 0)
+            break;
+
+        // Triangles that contained a collapsed edge are now degenerate
+        size_t write = 0;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            uint32_t a = target[indices[i]], b = target[indices[i + 1]], c = target[indices[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            indices[write++] = a;
+            indices[write++] = b;
+            indices[write++] = c;
+        }
+        indices.resize(write);
+    }
+    return committed;
+}
+
+}
+
+float simplifyMesh(const std::vector<uint32_t>& indices, const glm::vec3* positions, size_t positionStride,
+                   size_t vertexCount, size_t targetIndexCount, float maxError, std::vector<uint32_t>& result) {
+    result.clear();
+    targetIndexCount -= targetIndexCount % 3;
+    if (indices.size() <= targetIndexCount || vertexCount == 0) {
+        result = indices;
+        return 0.0f;
+    }
+
+    auto position = [&](uint32_t vertex) -> const glm::vec3& {
+        return *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const unsigned char*>(positions) + vertex * positionStride);
+    };
+    size_t triangleCount = indices.size() / 3;
+
+    // Open and non-manifold edges lock their vertices, so silhouettes and seams stay in place
+    std::vector<uint8_t> locked(vertexCount, 0);
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int e = 0; e < 3; ++e) {
+            uint64_t a = indices[i + e], b = indices[i + (e + 1) % 3];
+            edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();) {
+        size_t run = i + 1;
+        while (run < edges.size() && edges[run] == edges[i])
+            ++run;
+        if (run - i != 2) {
+            locked[edges[i] >> 32] = 1;
+            locked[edges[i] & 0xffffffffu] = 1;
+        }
+        i = run;
+    }
+
+    // Morton-ordered triangle runs make compact clusters; their shared vertices get locked
+    std::vector<uint32_t> order(triangleCount);
+    std::iota(order.begin(), order.end(), 0);
+    size_t clusterCount = (triangleCount + kSimplifyClusterTriangles - 1) / kSimplifyClusterTriangles;
+    if (clusterCount > 1) {
+        std::vector<glm::vec3> centroids(triangleCount);
+        glm::vec3 low(std::numeric_limits<float>::max()), high(-std::numeric_limits<float>::max());
+        for (size_t t = 0; t < triangleCount; ++t) {
+            centroids[t] = (position(indices[t * 3]) + position(indices[t * 3 + 1]) + position(indices[t * 3 + 2])) / 3.0f;
+            low = glm::min(low, centroids[t]);
+            high = glm::max(high, centroids[t]);
+        }
+        glm::vec3 scale = glm::vec3(1023.0f) / glm::max(high - low, glm::vec3(1e-20f));
+        std::vector<uint32_t> codes(triangleCount);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            glm::vec3 cell = (centroids[t] - low) * scale;
+            codes[t] = (expandBits(static_cast<uint32_t>(cell.x)) << 2) | (expandBits(static_cast<uint32_t>(cell.y)) << 1)
+                     | expandBits(static_cast<uint32_t>(cell.z));
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return codes[a] < codes[b]; });
+
+        std::vector<uint32_t> owner(vertexCount, std::numeric_limits<uint32_t>::max());
+        for (size_t t = 0; t < triangleCount; ++t) {
+            uint32_t cluster = static_cast<uint32_t>(t / kSimplifyClusterTriangles);
+            for (int k = 0; k < 3; ++k) {
+                uint32_t vertex = indices[order[t] * 3 + k];
+                if (owner[vertex] == std::numeric_limits<uint32_t>::max())
+                    owner[vertex] = cluster;
+                else if (owner[vertex] != cluster)
+                    locked[vertex] = 1;
+            }
+        }
+    }
+
+    std::vector<std::vector<uint32_t>> clusterIndices(clusterCount);
+    std::vector<double> clusterCosts(clusterCount, 0.0);
+    double maxCost = static_cast<double>(maxError) * maxError;
+
+    parallelFor(clusterCount, 1, [&](size_t begin, size_t end) {
+        std::vector<uint32_t> vertexIds, local;
+        std::vector<glm::dvec3> localPositions;
+        std::vector<uint8_t> localLocked;
+
+        for (size_t cluster = begin; cluster < end; ++cluster) {
+            size_t first = cluster * kSimplifyClusterTriangles;
+            size_t last = std::min(first + kSimplifyClusterTriangles, triangleCount);
+
+            // Cluster-local numbering keeps the per-vertex state proportional to the cluster
+            vertexIds.clear();
+            for (size_t t = first; t < last; ++t) {
+                for (int k = 0; k < 3; ++k)
+                    vertexIds.push_back(indices[order[t] * 3 + k]);
+            }
+            local.resize((last - first) * 3);
+            std::sort(vertexIds.begin(), vertexIds.end());
+            vertexIds.erase(std::unique(vertexIds.begin(), vertexIds.end()), vertexIds.end());
+            for (size_t t = first; t < last; ++t) {
+                for (int k = 0; k < 3; ++k) {
+                    uint32_t vertex = indices[order[t] * 3 + k];
+                    local[(t - first) * 3 + k] = static_cast<uint32_t>(std::lower_bound(vertexIds.begin(), vertexIds.end(), vertex) - vertexIds.begin());
+                }
+            }
+
+            // Quadrics are built around the cluster centre to keep their constant terms small
+            glm::dvec3 center(0.0);
+            for (uint32_t vertex : vertexIds)
+                center += glm::dvec3(position(vertex));
+            center /= static_cast<double>(vertexIds.size());
+            localPositions.resize(vertexIds.size());
+            localLocked.resize(vertexIds.size());
+            for (size_t v = 0; v < vertexIds.size(); ++v) {
+                localPositions[v] = glm::dvec3(position(vertexIds[v])) - center;
+                localLocked[v] = locked[vertexIds[v]];
+            }
+
+            size_t clusterTarget = (targetIndexCount / 3) * (last - first) / triangleCount * 3;
+            clusterCosts[cluster] = simplifyCluster(local, localPositions, localLocked, clusterTarget, maxCost);
+
+            std::vector<uint32_t>& output = clusterIndices[cluster];
+            output.resize(local.size());
+            for (size_t i = 0; i < local.size(); ++i)
+                output[i] = vertexIds[local[i]];
+        }
+    });
+
+    double cost = 0.0;
+    for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+        result.insert(result.end(), clusterIndices[cluster].begin(), clusterIndices[cluster].end());
+        cost = std::max(cost, clusterCosts[cluster]);
+    }
+    return static_cast<float>(std::sqrt(cost));
+}
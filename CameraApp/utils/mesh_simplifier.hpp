@@ -0,0 +1,29 @@
+//
+//  mesh_simplifier.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/5/25.
+//
+
+#ifndef mesh_simplifier_hpp
+#define mesh_simplifier_hpp
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Triangles per spatial cluster. Clusters are simplified independently on the worker threads
+// with their shared border vertices locked, so there are no cracks between them.
+constexpr size_t kSimplifyClusterTriangles = 4096;
+
+// Quadric error metric edge collapse (Garland & Heckbert 1997). Vertices only ever collapse onto
+// one of their neighbours, so the result indexes the same vertex array and a LOD is just another
+// index range. Open edges keep their vertices. Stops at targetIndexCount, when the next collapse
+// would cost more than maxError, or when nothing can collapse without flipping a triangle.
+// positions is strided in bytes. Returns the largest error committed, an estimate of the RMS
+// distance from the original surface in position units.
+float simplifyMesh(const std::vector<uint32_t>& indices, const glm::vec3* positions, size_t positionStride,
+                   size_t vertexCount, size_t targetIndexCount, float maxError, std::vector<uint32_t>& result);
+
+#endif /* mesh_simplifier_hpp */
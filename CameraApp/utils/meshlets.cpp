@@ -0,0 +1,143 @@
+//
+//  meshlets.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/8/25.
+//
+
+#include "meshlets.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+void computeMeshletBounds(Meshlet& meshlet, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& meshletVertices,
+                          const glm::vec3* positions, size_t positionStride) {
+    auto position = [&](uint32_t vertex) -> const glm::vec3& {
+        return *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const unsigned char*>(positions) + vertex * positionStride);
+    };
+
+    glm::vec3 low(std::numeric_limits<float>::max()), high(-std::numeric_limits<float>::max());
+    for (uint32_t vertex : meshletVertices) {
+        low = glm::min(low, position(vertex));
+        high = glm::max(high, position(vertex));
+    }
+    meshlet.center = (low + high) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (uint32_t vertex : meshletVertices)
+        meshlet.radius = std::max(meshlet.radius, glm::length(position(vertex) - meshlet.center));
+
+    // Unit normals, so large triangles do not hide a small one facing the other way
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.triangleCount);
+    glm::vec3 sum(0.0f);
+    for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.triangleCount * 3; i += 3) {
+        const glm::vec3& p0 = position(indices[i]);
+        glm::vec3 normal = glm::cross(position(indices[i + 1]) - p0, position(indices[i + 2]) - p0);
+        float length = glm::length(normal);
+        if (length == 0.0f)
+            continue;
+        normals.push_back(normal / length);
+        sum += normals.back();
+    }
+
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+    float sumLength = glm::length(sum);
+    if (normals.empty() || sumLength < 1e-6f)
+        return;
+
+    meshlet.coneAxis = sum / sumLength;
+    float minDot = 1.0f;
+    for (const glm::vec3& normal : normals)
+        minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+    // A cone of 90 degrees or more always has a face toward the viewer
+    if (minDot > 0.0f)
+        meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+}
+
+void buildMeshlets(std::vector<uint32_t>& indices, const glm::vec3* positions, size_t positionStride, size_t vertexCount,
+                   std::vector<Meshlet>& meshlets, size_t maxVertices, size_t maxTriangles) {
+    meshlets.clear();
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || maxVertices < 3 || maxTriangles == 0)
+        return;
+
+    // Vertex -> triangles adjacency in CSR form
+    std::vector<uint32_t> offsets(vertexCount + 1, 0), adjacent(indices.size());
+    for (uint32_t index : indices)
+        ++offsets[index + 1];
+    for (size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] += offsets[v];
+    std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+        adjacent[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    // Index of the meshlet a vertex was last added to, so membership is a single compare
+    std::vector<uint32_t> owner(vertexCount, std::numeric_limits<uint32_t>::max());
+    std::vector<uint32_t> reordered;
+    reordered.reserve(indices.size());
+    std::vector<uint32_t> meshletVertices;
+
+    size_t seed = 0;
+    while (reordered.size() < indices.size()) {
+        while (emitted[seed])
+            ++seed;
+
+        uint32_t id = static_cast<uint32_t>(meshlets.size());
+        Meshlet meshlet;
+        meshlet.firstIndex = static_cast<uint32_t>(reordered.size());
+        meshletVertices.clear();
+
+        auto addTriangle = [&](uint32_t triangle) {
+            for (int k = 0; k < 3; ++k) {
+                uint32_t vertex = indices[triangle * 3 + k];
+                if (owner[vertex] != id) {
+                    owner[vertex] = id;
+                    meshletVertices.push_back(vertex);
+                }
+                reordered.push_back(vertex);
+            }
+            emitted[triangle] = 1;
+            ++meshlet.triangleCount;
+        };
+        addTriangle(static_cast<uint32_t>(seed));
+
+        while (meshlet.triangleCount < maxTriangles) {
+            uint32_t best = std::numeric_limits<uint32_t>::max();
+            int bestNew = 3;
+            for (size_t v = 0; v < meshletVertices.size() && bestNew > 0; ++v) {
+                uint32_t vertex = meshletVertices[v];
+                for (uint32_t k = offsets[vertex]; k < offsets[vertex + 1]; ++k) {
+                    uint32_t triangle = adjacent[k];
+                    if (emitted[triangle])
+                        continue;
+                    int added = 0;
+                    for (int c = 0; c < 3; ++c)
+                        added += owner[indices[triangle * 3 + c]] != id;
+                    if (meshletVertices.size() + added > maxVertices)
+                        continue;
+                    // Ties go to the earlier triangle, which keeps most of the cache order
+                    if (added < bestNew || (added == bestNew && triangle < best)) {
+                        best = triangle;
+                        bestNew = added;
+                    }
+                }
+            }
+            // Disconnected pieces start their own meshlet, which keeps the normal cones tight
+            if (best == std::numeric_limits<uint32_t>::max())
+                break;
+            addTriangle(best);
+        }
+
+        meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+        computeMeshletBounds(meshlet, reordered, meshletVertices, positions, positionStride);
+        meshlets.push_back(meshlet);
+    }
+    indices.swap(reordered);
+}
@@ -0,0 +1,48 @@
+//
+//  meshlets.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 8/8/25.
+//
+
+#ifndef meshlets_hpp
+#define meshlets_hpp
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+constexpr size_t kMeshletMaxVertices = 64;
+constexpr size_t kMeshletMaxTriangles = 124;
+
+// A small connected patch of triangles, contiguous in the mesh's index list
+struct Meshlet {
+    uint32_t firstIndex = 0;
+    uint32_t triangleCount = 0;
+    uint32_t vertexCount = 0;
+
+    // Bounding sphere
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // Every front face normal lies within the cone around coneAxis. coneCutoff is the sine of
+    // its half-angle, 1 when the normals spread too far for the cone to reject anything.
+    glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float coneCutoff = 1.0f;
+};
+
+// Greedily grows meshlets from the current triangle order (run the vertex cache optimizer first),
+// preferring the neighbour that adds the fewest new vertices. Reorders indices so each meshlet is
+// one range. Front faces are counter-clockwise. positions is strided in bytes.
+void buildMeshlets(std::vector<uint32_t>& indices, const glm::vec3* positions, size_t positionStride, size_t vertexCount,
+                   std::vector<Meshlet>& meshlets, size_t maxVertices = kMeshletMaxVertices, size_t maxTriangles = kMeshletMaxTriangles);
+
+// True when the whole sphere sees only back faces from the eye: the direction to the meshlet is
+// within 90 degrees minus the cone angle of the axis, with the sphere radius as slack
+inline bool isMeshletBackFacing(const glm::vec3& center, float radius, const glm::vec3& coneAxis, float coneCutoff, const glm::vec3& eye) {
+    glm::vec3 toCenter = center - eye;
+    return glm::dot(toCenter, coneAxis) >= coneCutoff * glm::length(toCenter) + radius;
+}
+
+#endif /* meshlets_hpp */
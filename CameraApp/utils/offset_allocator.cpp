@@ -0,0 +1,258 @@
+//
+//  offset_allocator.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/17/25.
+//
+
+#include "offset_allocator.hpp"
+
+#include <algorithm>
+
+namespace {
+
+constexpr uint32_t kMantissaBits = 3;
+constexpr uint32_t kMantissaValue = 1 << kMantissaBits;
+constexpr uint32_t kMantissaMask = kMantissaValue - 1;
+
+uint32_t highestBit(uint32_t value) {
+    return 31 - static_cast<uint32_t>(__builtin_clz(value));
+}
+
+uint32_t lowestBitAtOrAfter(uint32_t mask, uint32_t start) {
+    uint32_t masked = start < 32 ? mask & ~((1u << start) - 1) : 0;
+    return masked ? static_cast<uint32_t>(__builtin_ctz(masked)) : OffsetAllocator::kNoSpace;
+}
+
+// Size -> bin as a tiny float: sizes below 8 are exact, above that 3 mantissa bits per octave.
+// Rounding up on allocate guarantees any range in the chosen bin is large enough.
+uint32_t sizeToBinRoundUp(uint32_t size) {
+    if (size < kMantissaValue)
+        return size;
+
+    uint32_t mantissaStart = highestBit(size) - kMantissaBits;
+    uint32_t bin = ((mantissaStart + 1) << kMantissaBits) + ((size >> mantissaStart) & kMantissaMask);
+    if (size & ((1u << mantissaStart) - 1))
+        ++bin;  // may carry into the next exponent, which is still correct
+    return bin;
+}
+
+uint32_t sizeToBinRoundDown(uint32_t size) {
+    if (size < kMantissaValue)
+        return size;
+
+    uint32_t mantissaStart = highestBit(size) - kMantissaBits;
+    return ((mantissaStart + 1) << kMantissaBits) + ((size >> mantissaStart) & kMantissaMask);
+}
+
+}
+
+OffsetAllocator::OffsetAllocator(uint32_t size, uint32_t maxAllocations) {
+    reset(size, maxAllocations);
+}
+
+void OffsetAllocator::reset(uint32_t newSize, uint32_t maxAllocations) {
+    size = newSize;
+    freeStorage = 0;
+    usedTopBins = 0;
+    std::fill(std::begin(usedLeafBins), std::end(usedLeafBins), 0);
+    std::fill(std::begin(binHeads), std::end(binHeads), kUnused);
+
+    // An empty allocator holds no pool, so idle and cleaned-up owners cost no host memory
+    if (size == 0) {
+        std::vector<Node>().swap(nodes);
+        std::vector<uint32_t>().swap(freeNodes);
+        return;
+    }
+
+    // Every live range (used or free) takes a node, the pool never grows
+    nodes.assign(maxAllocations + 1, Node());
+    freeNodes.resize(maxAllocations + 1);
+    for (uint32_t i = 0; i <= maxAllocations; ++i)
+        freeNodes[i] = maxAllocations - i;
+    insertFreeNode(0, size);
+}
+
+uint32_t OffsetAllocator::findBin(uint32_t request) const {
+    if (request == 0 || freeNodes.empty())
+        return kNoSpace;
+
+    uint32_t minBin = sizeToBinRoundUp(request);
+    if (minBin >= kLeafBinCount)
+        return kNoSpace;
+
+    uint32_t topBin = minBin / kBinsPerLeaf;
+    uint32_t leafBin = kNoSpace;
+    if (usedTopBins & (1u << topBin))
+        leafBin = lowestBitAtOrAfter(usedLeafBins[topBin], minBin % kBinsPerLeaf);
+
+    // Nothing big enough in this octave, take the smallest bin of the next used one
+    if (leafBin == kNoSpace) {
+        topBin = lowestBitAtOrAfter(usedTopBins, topBin + 1);
+        if (topBin == kNoSpace)
+            return kNoSpace;
+        leafBin = static_cast<uint32_t>(__builtin_ctz(usedLeafBins[topBin]));
+    }
+    return topBin * kBinsPerLeaf + leafBin;
+}
+
+OffsetAllocator::Allocation OffsetAllocator::allocate(uint32_t request) {
+    uint32_t bin = findBin(request);
+    if (bin == kNoSpace)
+        return Allocation();
+
+    uint32_t topBin = bin / kBinsPerLeaf;
+    uint32_t leafBin = bin % kBinsPerLeaf;
+    uint32_t nodeIndex = binHeads[bin];
+    Node& node = nodes[nodeIndex];
+    uint32_t nodeTotal = node.size;
+
+    // Pop from the bin
+    binHeads[bin] = node.binNext;
+    if (node.binNext != kUnused)
+        nodes[node.binNext].binPrev = kUnused;
+    if (binHeads[bin] == kUnused) {
+        usedLeafBins[topBin] &= static_cast<uint8_t>(~(1u << leafBin));
+        if (usedLeafBins[topBin] == 0)
+            usedTopBins &= ~(1u << topBin);
+    }
+    freeStorage -= nodeTotal;
+
+    node.size = request;
+    node.used = true;
+    node.binPrev = node.binNext = kUnused;
+
+    // The remainder goes back as a free neighbor
+    uint32_t remainder = nodeTotal - request;
+    if (remainder > 0) {
+        uint32_t remainderIndex = insertFreeNode(node.offset + request, remainder);
+        Node& remainderNode = nodes[remainderIndex];
+        Node& current = nodes[nodeIndex];
+        if (current.neighborNext != kUnused)
+            nodes[current.neighborNext].neighborPrev = remainderIndex;
+        remainderNode.neighborPrev = nodeIndex;
+        remainderNode.neighborNext = current.neighborNext;
+        current.neighborNext = remainderIndex;
+    }
+
+    Allocation allocation;
+    allocation.offset = nodes[nodeIndex].offset;
+    allocation.node = nodeIndex;
+    return allocation;
+}
+
+void OffsetAllocator::free(Allocation allocation) {
+    if (!allocation.isValid() || allocation.node >= nodes.size() || !nodes[allocation.node].used)
+        return;
+
+    uint32_t nodeIndex = allocation.node;
+    uint32_t offset = nodes[nodeIndex].offset;
+    uint32_t rangeSize = nodes[nodeIndex].size;
+
+    // Merge with free neighbors, each merged node returns to the pool
+    uint32_t prev = nodes[nodeIndex].neighborPrev;
+    if (prev != kUnused && !nodes[prev].used) {
+        offset = nodes[prev].offset;
+        rangeSize += nodes[prev].size;
+        removeFreeNode(prev);
+        nodes[nodeIndex].neighborPrev = nodes[prev].neighborPrev;
+        if (nodes[prev].neighborPrev != kUnused)
+            nodes[nodes[prev].neighborPrev].neighborNext = nodeIndex;
+        freeNodes.push_back(prev);
+    }
+
+    uint32_t next = nodes[nodeIndex].neighborNext;
+    if (next != kUnused && !nodes[next].used) {
+        rangeSize += nodes[next].size;
+        removeFreeNode(next);
+        nodes[nodeIndex].neighborNext = nodes[next].neighborNext;
+        if (nodes[next].neighborNext != kUnused)
+            nodes[nodes[next].neighborNext].neighborPrev = nodeIndex;
+        freeNodes.push_back(next);
+    }
+
+    uint32_t neighborPrev = nodes[nodeIndex].neighborPrev;
+    uint32_t neighborNext = nodes[nodeIndex].neighborNext;
+    nodes[nodeIndex].used = false;
+    freeNodes.push_back(nodeIndex);
+
+    uint32_t mergedIndex = insertFreeNode(offset, rangeSize);
+    nodes[mergedIndex].neighborPrev = neighborPrev;
+    nodes[mergedIndex].neighborNext = neighborNext;
+    if (neighborPrev != kUnused)
+        nodes[neighborPrev].neighborNext = mergedIndex;
+    if (neighborNext != kUnused)
+        nodes[neighborNext].neighborPrev = mergedIndex;
+}
+
+uint32_t OffsetAllocator::allocationSize(Allocation allocation) const {
+    if (!allocation.isValid() || allocation.node >= nodes.size())
+        return 0;
+    return nodes[allocation.node].size;
+}
+
+OffsetAllocator::StorageReport OffsetAllocator::storageReport() const {
+    StorageReport report;
+    report.totalFree = freeStorage;
+    report.allocations = static_cast<uint32_t>(nodes.size() - freeNodes.size());
+
+    for (uint32_t bin = 0; bin < kLeafBinCount; ++bin) {
+        for (uint32_t index = binHeads[bin]; index != kUnused; index = nodes[index].binNext) {
+            report.largestFree = std::max(report.largestFree, nodes[index].size);
+            ++report.freeRegions;
+        }
+    }
+    report.allocations -= report.freeRegions;
+    return report;
+}
+
+uint32_t OffsetAllocator::insertFreeNode(uint32_t offset, uint32_t rangeSize) {
+    // Round down so every range in a bin is at least the bin's size
+    uint32_t bin = sizeToBinRoundDown(rangeSize);
+    uint32_t topBin = bin / kBinsPerLeaf;
+    uint32_t leafBin = bin % kBinsPerLeaf;
+
+    if (binHeads[bin] == kUnused) {
+        usedLeafBins[topBin] |= static_cast<uint8_t>(1u << leafBin);
+        usedTopBins |= 1u << topBin;
+    }
+
+    uint32_t nodeIndex = freeNodes.back();
+    freeNodes.pop_back();
+
+    Node& node = nodes[nodeIndex];
+    node = Node();
+    node.offset = offset;
+    node.size = rangeSize;
+    node.binNext = binHeads[bin];
+    if (binHeads[bin] != kUnused)
+        nodes[binHeads[bin]].binPrev = nodeIndex;
+    binHeads[bin] = nodeIndex;
+
+    freeStorage += rangeSize;
+    return nodeIndex;
+}
+
+void OffsetAllocator::removeFreeNode(uint32_t nodeIndex) {
+    Node& node = nodes[nodeIndex];
+
+    if (node.binPrev != kUnused) {
+        nodes[node.binPrev].binNext = node.binNext;
+        if (node.binNext != kUnused)
+            nodes[node.binNext].binPrev = node.binPrev;
+    } else {
+        uint32_t bin = sizeToBinRoundDown(node.size);
+        binHeads[bin] = node.binNext;
+        if (node.binNext != kUnused)
+            nodes[node.binNext].binPrev = kUnused;
+
+        if (binHeads[bin] == kUnused) {
+            uint32_t topBin = bin / kBinsPerLeaf;
+            usedLeafBins[topBin] &= static_cast<uint8_t>(~(1u << (bin % kBinsPerLeaf)));
+            if (usedLeafBins[topBin] == 0)
+                usedTopBins &= ~(1u << topBin);
+        }
+    }
+
+    freeStorage -= node.size;
+}
@@ -0,0 +1,83 @@
+//
+//  offset_allocator.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/17/25.
+//
+
+#ifndef offset_allocator_hpp
+#define offset_allocator_hpp
+
+#include <cstdint>
+#include <vector>
+
+// Hands out [offset, offset + size) ranges of an external resource such as a GL buffer.
+// Free ranges sit in 256 size classes (TLSF: power-of-two exponent plus 3 mantissa bits)
+// found through two bitmap levels, so allocate and free are O(1) and adjacent free
+// ranges are merged immediately. Units are whatever the caller counts in.
+class OffsetAllocator {
+public:
+    static constexpr uint32_t kNoSpace = 0xffffffffu;
+
+    struct Allocation {
+        uint32_t offset = kNoSpace;
+        uint32_t node = kNoSpace;
+        bool isValid() const { return offset != kNoSpace; }
+    };
+
+    struct StorageReport {
+        uint32_t totalFree = 0;
+        uint32_t largestFree = 0;
+        uint32_t freeRegions = 0;
+        uint32_t allocations = 0;
+        // 0 when all free space is one range, towards 1 as it splinters
+        float fragmentation() const {
+            return totalFree ? 1.0f - static_cast<float>(largestFree) / totalFree : 0.0f;
+        }
+    };
+
+    explicit OffsetAllocator(uint32_t size = 0, uint32_t maxAllocations = 128 * 1024);
+
+    void reset(uint32_t size, uint32_t maxAllocations = 128 * 1024);
+    Allocation allocate(uint32_t size);
+    void free(Allocation allocation);
+    // Whether allocate(size) would succeed right now
+    bool canAllocate(uint32_t size) const { return findBin(size) != kNoSpace; }
+    // Smallest total size that is sure to serve allocate(size): requests round up to their size
+    // class and free ranges round down, so an exact fit can miss by up to one class (1/8)
+    static uint32_t capacityFor(uint32_t size) { return size + size / 8 + kBinsPerLeaf; }
+
+    uint32_t allocationSize(Allocation allocation) const;
+    uint32_t getSize() const { return size; }
+    StorageReport storageReport() const;
+
+private:
+    static constexpr uint32_t kTopBinCount = 32;
+    static constexpr uint32_t kBinsPerLeaf = 8;
+    static constexpr uint32_t kLeafBinCount = kTopBinCount * kBinsPerLeaf;
+    static constexpr uint32_t kUnused = 0xffffffffu;
+
+    struct Node {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        uint32_t binPrev = kUnused, binNext = kUnused;
+        uint32_t neighborPrev = kUnused, neighborNext = kUnused;
+        bool used = false;
+    };
+
+    uint32_t size = 0;
+    uint32_t freeStorage = 0;
+
+    uint32_t usedTopBins = 0;
+    uint8_t usedLeafBins[kTopBinCount] = {};
+    uint32_t binHeads[kLeafBinCount];
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+
+    uint32_t findBin(uint32_t request) const;
+    uint32_t insertFreeNode(uint32_t offset, uint32_t size);
+    void removeFreeNode(uint32_t nodeIndex);
+};
+
+#endif /* offset_allocator_hpp */
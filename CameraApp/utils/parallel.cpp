@@ -0,0 +1,128 @@
+//
+//  parallel.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/7/25.
+//
+
+#include "parallel.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// One parallelFor call: ranges are claimed by index, the caller's thread included
+struct Batch {
+    const std::function<void(size_t, size_t)>* body = nullptr;
+    size_t count = 0;
+    size_t rangeSize = 0;
+    size_t ranges = 0;
+    size_t next = 0;       // guarded by the pool mutex, like finished
+    size_t finished = 0;
+};
+
+// Threads started once and parked between calls; per-frame callers such as the meshlet culler
+// would otherwise pay thread creation every frame. Callers work through their own batch too,
+// so nested and concurrent calls (BVH subtrees, the PLY decoder thread) cannot deadlock.
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned threadCount) {
+        for (unsigned i = 0; i < threadCount; ++i)
+            threads.emplace_back(&WorkerPool::workLoop, this);
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    void run(Batch& batch) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(&batch);
+        }
+        workAvailable.notify_all();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (batch.next < batch.ranges)
+            runRange(batch, batch.next++, lock);
+        // Workers only reach a batch through the queue and under the lock, so once every claimed
+        // range has finished it can go out of scope
+        batchFinished.wait(lock, [&batch] { return batch.finished == batch.ranges; });
+        queue.erase(std::remove(queue.begin(), queue.end(), &batch), queue.end());
+    }
+
+private:
+    void workLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            workAvailable.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            Batch& batch = *queue.front();
+            if (batch.next >= batch.ranges) {
+                queue.pop_front();
+                continue;
+            }
+            runRange(batch, batch.next++, lock);
+        }
+    }
+
+    // Called and returns with the lock held
+    void runRange(Batch& batch, size_t range, std::unique_lock<std::mutex>& lock) {
+        size_t begin = range * batch.rangeSize;
+        size_t end = std::min(batch.count, begin + batch.rangeSize);
+        lock.unlock();
+        if (begin < end)
+            (*batch.body)(begin, end);
+        lock.lock();
+        if (++batch.finished == batch.ranges)
+            batchFinished.notify_all();
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable workAvailable, batchFinished;
+    std::deque<Batch*> queue;
+    bool stopping = false;
+};
+
+WorkerPool& workerPool() {
+    // The calling thread is one of the workers
+    static WorkerPool pool(workerCount() - 1);
+    return pool;
+}
+
+}
+
+unsigned workerCount() {
+    static const unsigned count = std::max(1u, std::thread::hardware_concurrency());
+    return count;
+}
+
+void parallelFor(size_t count, size_t minRange, const std::function<void(size_t, size_t)>& body) {
+    if (count == 0)
+        return;
+
+    size_t ranges = std::min<size_t>(workerCount(), (count + std::max<size_t>(minRange, 1) - 1) / std::max<size_t>(minRange, 1));
+    if (ranges <= 1) {
+        body(0, count);
+        return;
+    }
+
+    Batch batch;
+    batch.body = &body;
+    batch.count = count;
+    batch.rangeSize = (count + ranges - 1) / ranges;
+    batch.ranges = ranges;
+    workerPool().run(batch);
+}
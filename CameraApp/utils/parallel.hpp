@@ -0,0 +1,21 @@
+//
+//  parallel.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/7/25.
+//
+
+#ifndef parallel_hpp
+#define parallel_hpp
+
+#include <cstddef>
+#include <functional>
+
+unsigned workerCount();
+
+// Splits [0, count) into contiguous ranges of at least minRange items and runs
+// body(begin, end) on up to workerCount() threads of a persistent pool, the caller's
+// included; blocks until all ranges finish. Safe to nest and to call from several threads.
+void parallelFor(size_t count, size_t minRange, const std::function<void(size_t, size_t)>& body);
+
+#endif /* parallel_hpp */
@@ -0,0 +1,62 @@
+//
+//  shader_utils.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 6/30/25.
+//
+
+#include "shader_utils.hpp"
+#include <iostream>
+#include <vector>
+
+GLuint compileShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> log(length > 0 ? length : 1);
+        glGetShaderInfoLog(shader, static_cast<GLsizei>(log.size()), NULL, log.data());
+        std::cerr << "Shader compilation failed:\n" << log.data() << "\n";
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint buildProgram(const char* vertexSource, const char* geometrySource, const char* fragmentSource) {
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint geometryShader = geometrySource ? compileShader(GL_GEOMETRY_SHADER, geometrySource) : 0;
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+
+    GLuint program = 0;
+    if (vertexShader && fragmentShader && (geometryShader || !geometrySource)) {
+        program = glCreateProgram();
+        glAttachShader(program, vertexShader);
+        if (geometryShader)
+            glAttachShader(program, geometryShader);
+        glAttachShader(program, fragmentShader);
+        glLinkProgram(program);
+
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status != GL_TRUE) {
+            GLint length = 0;
+            glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+            std::vector<char> log(length > 0 ? length : 1);
+            glGetProgramInfoLog(program, static_cast<GLsizei>(log.size()), NULL, log.data());
+            std::cerr << "Program link failed:\n" << log.data() << "\n";
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(geometryShader);
+    glDeleteShader(fragmentShader);
+    return program;
+}
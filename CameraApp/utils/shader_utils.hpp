@@ -0,0 +1,17 @@
+//
+//  shader_utils.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 6/30/25.
+//
+
+#ifndef shader_utils_hpp
+#define shader_utils_hpp
+
+#include <GL/glew.h>
+
+GLuint compileShader(GLenum type, const char* source);
+// geometrySource may be null; returns 0 and logs the info log when compiling or linking fails
+GLuint buildProgram(const char* vertexSource, const char* geometrySource, const char* fragmentSource);
+
+#endif /* shader_utils_hpp */
@@ -0,0 +1,60 @@
+//
+//  triple_buffer.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 6/16/25.
+//
+
+#ifndef triple_buffer_hpp
+#define triple_buffer_hpp
+
+#include <atomic>
+#include <cstdint>
+
+// Single-producer / single-consumer triple buffer. The writer fills its private slot and
+// publishes it by swapping with the shared middle slot; the reader swaps the middle slot
+// into its private slot only when something new was published. Neither side ever blocks
+// and the reader always sees a complete value.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer thread
+    T& writeBuffer() { return slots[writeIndex]; }
+
+    void publish() {
+        uint8_t previous = middle.exchange(writeIndex | kFreshBit, std::memory_order_acq_rel);
+        writeIndex = previous & kIndexMask;
+    }
+
+    void write(const T& value) {
+        writeBuffer() = value;
+        publish();
+    }
+
+    // Reader thread, returns false when nothing was published since the last call
+    bool consume() {
+        if ((middle.load(std::memory_order_relaxed) & kFreshBit) == 0)
+            return false;
+        uint8_t previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & kIndexMask;
+        return true;
+    }
+
+    const T& readBuffer() const { return slots[readIndex]; }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kFreshBit = 0x4;
+
+    T slots[3] = {};
+    // Keep the shared index away from the slots and the per-thread indices
+    alignas(64) std::atomic<uint8_t> middle{1};
+    alignas(64) uint8_t writeIndex = 0;
+    alignas(64) uint8_t readIndex = 2;
+};
+
+#endif /* triple_buffer_hpp */
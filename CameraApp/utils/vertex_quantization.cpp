@@ -0,0 +1,91 @@
+//
+//  vertex_quantization.cpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/28/25.
+//
+
+#include "vertex_quantization.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+PositionQuantization PositionQuantization::fromBounds(const BoundingBox& bounds) {
+    PositionQuantization quantization;
+    if (bounds.isEmpty())
+        return quantization;
+
+    quantization.center = bounds.center();
+    // Flat axes still need a nonzero scale to stay invertible
+    quantization.halfExtent = glm::max(bounds.extent(), glm::vec3(1e-6f));
+    return quantization;
+}
+
+glm::mat4 PositionQuantization::decodeMatrix() const {
+    glm::mat4 decode(1.0f);
+    decode[0][0] = halfExtent.x;
+    decode[1][1] = halfExtent.y;
+    decode[2][2] = halfExtent.z;
+    decode[3] = glm::vec4(center, 1.0f);
+    return decode;
+}
+
+// GL maps snorm16 as max(c / 32767, -1), so encode against 32767 as well
+int16_t encodeSnorm16(float value) {
+    float clamped = std::min(std::max(value, -1.0f), 1.0f);
+    return static_cast<int16_t>(std::lround(clamped * 32767.0f));
+}
+
+float decodeSnorm16(int16_t value) {
+    return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+}
+
+uint8_t encodeUnorm8(float value) {
+    float clamped = std::min(std::max(value, 0.0f), 1.0f);
+    return static_cast<uint8_t>(std::lround(clamped * 255.0f));
+}
+
+PackedVertex packVertex(const glm::vec3& position, const glm::vec3& color, const PositionQuantization& quantization) {
+    glm::vec3 normalized = (position - quantization.center) / quantization.halfExtent;
+
+    PackedVertex vertex;
+    vertex.position[0] = encodeSnorm16(normalized.x);
+    vertex.position[1] = encodeSnorm16(normalized.y);
+    vertex.position[2] = encodeSnorm16(normalized.z);
+    vertex.position[3] = 0;
+    vertex.color[0] = encodeUnorm8(color.x);
+    vertex.color[1] = encodeUnorm8(color.y);
+    vertex.color[2] = encodeUnorm8(color.z);
+    vertex.color[3] = 255;
+    return vertex;
+}
+
+glm::vec3 unpackPosition(const PackedVertex& vertex, const PositionQuantization& quantization) {
+    glm::vec3 normalized(decodeSnorm16(vertex.position[0]), decodeSnorm16(vertex.position[1]), decodeSnorm16(vertex.position[2]));
+    return quantization.center + normalized * quantization.halfExtent;
+}
+
+void encodeOctahedral(const glm::vec3& normal, int16_t encoded[2]) {
+    // Project onto the octahedron |x| + |y| + |z| = 1, fold the lower half over the diagonals
+    glm::vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+    float x = n.x, y = n.y;
+    if (n.z < 0.0f) {
+        x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    encoded[0] = encodeSnorm16(x);
+    encoded[1] = encodeSnorm16(y);
+}
+
+glm::vec3 decodeOctahedral(const int16_t encoded[2]) {
+    float x = decodeSnorm16(encoded[0]);
+    float y = decodeSnorm16(encoded[1]);
+    glm::vec3 n(x, y, 1.0f - std::abs(x) - std::abs(y));
+    if (n.z < 0.0f) {
+        float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        n.x = foldedX;
+        n.y = foldedY;
+    }
+    return glm::normalize(n);
+}
@@ -0,0 +1,49 @@
+//
+//  vertex_quantization.hpp
+//  CameraApp
+//
+//  Created by Danil Rostov on 7/28/25.
+//
+
+#ifndef vertex_quantization_hpp
+#define vertex_quantization_hpp
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+#include "bounds.hpp"
+
+// 12-byte vertex: position as snorm16 inside the mesh AABB (w pads to 8 bytes), color as RGBA8
+struct PackedVertex {
+    int16_t position[4];
+    uint8_t color[4];
+};
+
+// Maps the AABB to [-1, 1]^3 and back; decode(encode(p)) is p up to half a quantization step
+struct PositionQuantization {
+    glm::vec3 center = glm::vec3(0.0f);
+    glm::vec3 halfExtent = glm::vec3(1.0f);
+
+    static PositionQuantization fromBounds(const BoundingBox& bounds);
+    // Transform applied to decoded snorm positions to get back to mesh space
+    glm::mat4 decodeMatrix() const;
+};
+
+struct QuantizationError {
+    float maxPosition = 0.0f;      // mesh units
+    float maxPositionRelative = 0.0f;  // fraction of the AABB diagonal
+    float maxColor = 0.0f;         // 0..1
+};
+
+int16_t encodeSnorm16(float value);
+float decodeSnorm16(int16_t value);
+uint8_t encodeUnorm8(float value);
+
+PackedVertex packVertex(const glm::vec3& position, const glm::vec3& color, const PositionQuantization& quantization);
+glm::vec3 unpackPosition(const PackedVertex& vertex, const PositionQuantization& quantization);
+
+// Octahedral unit-vector encoding for normals, two snorm16 components
+void encodeOctahedral(const glm::vec3& normal, int16_t encoded[2]);
+glm::vec3 decodeOctahedral(const int16_t encoded[2]);
+
+#endif /* vertex_quantization_hpp */